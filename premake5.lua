@@ -29,6 +29,10 @@ workspace "AnkaEngine"
 			"src/external/Pyrrhic/*.h"
 		}
 		
+		removefiles
+		{
+			"src/evaluation/evaltuning.cpp"
+		}
 		
 		targetdir ("bin/%{cfg.buildcfg}")
 		objdir ("build_files/%{cfg.buildcfg}")
@@ -73,5 +77,76 @@ workspace "AnkaEngine"
 			{
 				"-mlzcnt",
 				"-mpopcnt",
-				"-mbmi"
-			}
\ No newline at end of file
+				"-mbmi",
+				"-mssse3"
+			}
+	
+	-- Texel tuner for the classical evaluation parameters (see src/evaluation/evaltuning.cpp)
+	project "AnkaTuner"
+		kind "ConsoleApp"
+		language "C++"
+		cppdialect "C++17"
+		staticruntime "on"
+		
+		files
+		{
+			"src/*.hpp",
+			"src/evaluation/*.hpp",
+			"src/attacks.cpp",
+			"src/gamestate.cpp",
+			"src/hash.cpp",
+			"src/makeundo.cpp",
+			"src/move.cpp",
+			"src/packedpos.cpp",
+			"src/validation.cpp",
+			"src/evaluation/classical_evaluation.cpp",
+			"src/evaluation/endgame.cpp",
+			"src/evaluation/material.cpp",
+			"src/evaluation/evaltuning.cpp"
+		}
+		
+		defines {"EVAL_TUNING"}
+		
+		targetdir ("bin/%{cfg.buildcfg}")
+		objdir ("build_files/tuner/%{cfg.buildcfg}")
+		
+		includedirs
+		{
+			"src",
+			"src/evaluation"
+		}
+		
+		filter "configurations:Debug"
+			defines {"ANKA_DEBUG"}
+			runtime "Debug"
+			symbols "on"
+		
+		filter "configurations:Release"
+			runtime "Release"
+			optimize "Speed"
+			intrinsics "on"
+			flags
+			{
+				"LinkTimeOptimization"
+			}
+			
+		filter "system:windows"
+			defines
+			{
+				"_CRT_SECURE_NO_WARNINGS"
+			}
+			systemversion "latest"
+		
+		filter "system:not windows"
+			links
+			{
+				"pthread"
+			}
+
+			buildoptions 
+			{
+				"-mlzcnt",
+				"-mpopcnt",
+				"-mbmi",
+				"-mssse3"
+			}
@@ -3,6 +3,7 @@
 #include "rng.hpp"
 #include "attacks.hpp"
 #include "evaluation.hpp"
+#include "endgame.hpp"
 #include "engine_settings.hpp"
 #include "search.hpp"
 #include "tbprobe.h"
@@ -10,7 +11,6 @@
 namespace anka {
 	// Global structures
 	TranspositionTable g_trans_table;
-	EvalParams g_eval_params;
 }
 
 
@@ -26,7 +26,7 @@ int main()
 	InitZobristKeys(rng);
 	attacks::InitAttacks();
 
-	g_eval_params.InitPST();
+	InitEndgames();
 	
 	if (!g_trans_table.Init(EngineSettings::DEFAULT_HASH_SIZE)) {
 		fprintf(stderr, "Failed to allocate transposition table memory\n");
@@ -40,6 +40,6 @@ int main()
 	uci::UciLoop();
 
 	tb_free();
-	FreeSearchStack();
+	FreeSearch();
 	return 0;
 }
\ No newline at end of file
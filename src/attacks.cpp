@@ -15,25 +15,6 @@ namespace anka {
 		Bitboard _file_masks[8];
 
 
-		template <int dir>
-		static Bitboard Fill(Bitboard b)
-		{
-			static_assert(dir == NORTH || dir == SOUTH, "Invalid fill direction");
-			
-			if constexpr (dir == NORTH) {
-				b |= (b << 8);
-				b |= (b << 16);
-				b |= (b << 32);
-			}
-			else if constexpr (dir == SOUTH) {
-				b |= (b >> 8);
-				b |= (b >> 16);
-				b |= (b >> 32);
-			}
-
-			return b;
-		}
-
 		Bitboard RookAttacksSlow(Square sq, Bitboard relevant_occ)
 		{
 			Bitboard attack_map{};
@@ -210,8 +191,8 @@ namespace anka {
 				bitboard::SetBit(b, sq);
 				b |= bitboard::StepOne<WEST>(b);
 				b |= bitboard::StepOne<EAST>(b);
-				_pawn_front_spans[WHITE][sq] = Fill<NORTH>(bitboard::StepOne<NORTH>(b));
-				_pawn_front_spans[BLACK][sq] = Fill<SOUTH>(bitboard::StepOne<SOUTH>(b));
+				_pawn_front_spans[WHITE][sq] = bitboard::Fill<NORTH>(bitboard::StepOne<NORTH>(b));
+				_pawn_front_spans[BLACK][sq] = bitboard::Fill<SOUTH>(bitboard::StepOne<SOUTH>(b));
 			}
 		}
 
@@ -223,7 +204,7 @@ namespace anka {
 				b |= bitboard::StepOne<WEST>(b);
 				b |= bitboard::StepOne<EAST>(b);
 				bitboard::ClearBit(b, sq);
-				_adjacent_files[sq] = Fill<NORTH>(b);
+				_adjacent_files[sq] = bitboard::Fill<NORTH>(b);
 			}
 
 		}
@@ -233,7 +214,7 @@ namespace anka {
 			for (Square sq = A1; sq <= H1; sq++) {
 				Bitboard b = 0;
 				bitboard::SetBit(b, sq);
-				_file_masks[sq] = Fill<NORTH>(b);
+				_file_masks[sq] = bitboard::Fill<NORTH>(b);
 			}
 		}
 
@@ -1,6 +1,15 @@
 #pragma once
 #include "bitboard.hpp"
 
+// Define ANKA_SIMD_SLIDERS in AVX2 builds to generate the slider attacks of the evaluation with SIMD fills
+// instead of magic lookups. Off by default: the magic lookups were faster where it was measured (anka_sliderbench).
+#if defined(ANKA_SIMD_SLIDERS) && !defined(__AVX2__)
+#error "ANKA_SIMD_SLIDERS needs AVX2"
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace anka {
 	namespace attacks {
@@ -236,5 +245,66 @@ namespace anka {
 			return _in_between[from][to];
 		}
 
+		#ifdef __AVX2__
+		template <int shift>
+		force_inline __m256i ShiftLanes(__m256i b)
+		{
+			if constexpr (shift > 0)
+				return _mm256_slli_epi64(b, shift);
+			else
+				return _mm256_srli_epi64(b, -shift);
+		}
+
+		// Kogge-Stone occluded fill from the generator bits towards 'dir', shifted one more step to get the attacks.
+		// The fill stops at the first occupied square, which is included in the attacks.
+		template <int dir>
+		force_inline __m256i DirectionAttacks(__m256i gen, __m256i empty)
+		{
+			// squares a step towards 'dir' can reach without wrapping around the board
+			constexpr u64 reachable = (dir == EAST || dir == NORTHEAST || dir == SOUTHEAST) ? C64(0xfefefefefefefefe)
+				: (dir == WEST || dir == NORTHWEST || dir == SOUTHWEST) ? C64(0x7f7f7f7f7f7f7f7f) : ~C64(0);
+			const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(reachable));
+
+			__m256i pro = _mm256_and_si256(empty, mask);
+			gen = _mm256_or_si256(gen, _mm256_and_si256(pro, ShiftLanes<dir>(gen)));
+			pro = _mm256_and_si256(pro, ShiftLanes<dir>(pro));
+			gen = _mm256_or_si256(gen, _mm256_and_si256(pro, ShiftLanes<2 * dir>(gen)));
+			pro = _mm256_and_si256(pro, ShiftLanes<2 * dir>(pro));
+			gen = _mm256_or_si256(gen, _mm256_and_si256(pro, ShiftLanes<4 * dir>(gen)));
+			return _mm256_and_si256(ShiftLanes<dir>(gen), mask);
+		}
+
+		// Attacks of up to 4 bishops, rooks or queens at once, one slider per 64-bit lane of an AVX2 register.
+		// The attacks are generated with Kogge-Stone occluded fills in the 8 directions instead of magic lookups.
+		// out[i] is the same as BishopAttacks/RookAttacks/QueenAttacks(squares[i], occupancy).
+		force_inline void SliderAttacksX4(const Square* squares, const PieceType* pieces, int count, Bitboard occupancy, Bitboard* out)
+		{
+			ANKA_ASSERT(count > 0 && count <= 4);
+			long long orthogonal[4]{};
+			long long diagonal[4]{};
+			for (int i = 0; i < count; i++) {
+				long long b = static_cast<long long>(C64(1) << squares[i]);
+				orthogonal[i] = pieces[i] != BISHOP ? b : 0;
+				diagonal[i] = pieces[i] != ROOK ? b : 0;
+			}
+
+			__m256i empty = _mm256_set1_epi64x(static_cast<long long>(~occupancy));
+			__m256i orth = _mm256_set_epi64x(orthogonal[3], orthogonal[2], orthogonal[1], orthogonal[0]);
+			__m256i diag = _mm256_set_epi64x(diagonal[3], diagonal[2], diagonal[1], diagonal[0]);
+
+			__m256i att = _mm256_or_si256(
+				_mm256_or_si256(DirectionAttacks<NORTH>(orth, empty), DirectionAttacks<SOUTH>(orth, empty)),
+				_mm256_or_si256(DirectionAttacks<EAST>(orth, empty), DirectionAttacks<WEST>(orth, empty)));
+			att = _mm256_or_si256(att, _mm256_or_si256(
+				_mm256_or_si256(DirectionAttacks<NORTHEAST>(diag, empty), DirectionAttacks<NORTHWEST>(diag, empty)),
+				_mm256_or_si256(DirectionAttacks<SOUTHEAST>(diag, empty), DirectionAttacks<SOUTHWEST>(diag, empty))));
+
+			alignas(32) u64 result[4];
+			_mm256_store_si256(reinterpret_cast<__m256i*>(result), att);
+			for (int i = 0; i < count; i++)
+				out[i] = result[i];
+		}
+		#endif
+
 	} // namespace attacks
 } // namespace anka
\ No newline at end of file
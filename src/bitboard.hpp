@@ -86,6 +86,32 @@ namespace anka {
 			}
 		}
 
+		// smears the bits towards 'dir' (NORTH or SOUTH), the original bits are kept
+		template <int dir>
+		force_inline Bitboard Fill(Bitboard bitboard)
+		{
+			static_assert(dir == NORTH || dir == SOUTH, "Invalid fill direction");
+
+			if constexpr (dir == NORTH) {
+				bitboard |= (bitboard << 8);
+				bitboard |= (bitboard << 16);
+				bitboard |= (bitboard << 32);
+			}
+			else {
+				bitboard |= (bitboard >> 8);
+				bitboard |= (bitboard >> 16);
+				bitboard |= (bitboard >> 32);
+			}
+
+			return bitboard;
+		}
+
+		// sets every square of the files that have at least one bit set
+		force_inline Bitboard FileFill(Bitboard bitboard)
+		{
+			return Fill<NORTH>(bitboard) | Fill<SOUTH>(bitboard);
+		}
+
 
 		// returns a subset of bits. selection defines the order of bits starting from the LSB
 		inline Bitboard BitSubset(Bitboard bitboard, const Bitboard selection)
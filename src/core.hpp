@@ -13,6 +13,7 @@ typedef uint8_t byte;
 typedef int64_t i64;
 typedef int32_t i32;
 typedef int16_t i16;
+typedef int8_t i8;
 
 #define C64(x) UINT64_C(x)
 #define C64_s(x) INT64_C(x)
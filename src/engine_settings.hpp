@@ -1,7 +1,13 @@
 #pragma once
 #include <limits.h>
+#include <string>
 
 namespace anka {
+	// Lazy: threads search the same tree independently and share only the transposition table.
+	// ABDADA: a speedup mode. threads also share "busy" flags and defer moves that another thread is searching.
+	// Neither mode is deterministic, a search recorded with the SearchLog option can be replayed exactly.
+	enum class ParallelMode { LAZY, ABDADA };
+
 	struct EngineSettings {
 		static constexpr const char* ENGINE_NAME = "Anka";
 		static constexpr const char* ENGINE_VERSION = "0.6.3";
@@ -11,9 +17,27 @@ namespace anka {
 		static constexpr int MIN_HASH_SIZE = 1;
 		static constexpr int MAX_HASH_SIZE = 1ULL << 18; // 256 GiB
 		static constexpr int PV_BUFFER_LENGTH = 64;
-		static constexpr int MOVE_OVERHEAD = 50;
+		static constexpr int DEFAULT_MOVE_OVERHEAD = 50;
+		static constexpr int MIN_MOVE_OVERHEAD = 0;
+		static constexpr int MAX_MOVE_OVERHEAD = 5000;
+		static constexpr int DEFAULT_MULTI_PV = 1;
+		static constexpr int MIN_MULTI_PV = 1;
+		static constexpr int MAX_MULTI_PV = 64;
+		static constexpr int DEFAULT_THREADS = 1;
+		static constexpr int MIN_THREADS = 1;
+		static constexpr int MAX_THREADS = 64;
+		static constexpr int DEFAULT_LAZY_EVAL_MARGIN = 400;
+		static constexpr int MIN_LAZY_EVAL_MARGIN = 0;
+		static constexpr int MAX_LAZY_EVAL_MARGIN = 5000;
 
 		int hash_size = DEFAULT_HASH_SIZE;
+		int move_overhead = DEFAULT_MOVE_OVERHEAD;
+		int multi_pv = DEFAULT_MULTI_PV;
+		int num_threads = DEFAULT_THREADS;
+		ParallelMode parallel_mode = ParallelMode::LAZY;
+		std::string search_log_path; // record searches if not empty
+		std::string eval_file; // NNUE network, classical evaluation if empty
+		int lazy_eval_margin = DEFAULT_LAZY_EVAL_MARGIN;
 	};
 
 	inline constexpr int ANKA_INFINITE = SHRT_MAX;
@@ -1,187 +1,449 @@
 #include "evaluation.hpp"
 #include "boarddefs.hpp"
 #include "movegen.hpp"
-
+#include "evalcache.hpp"
+#include "material.hpp"
+#include "pawnhash.hpp"
 
 namespace anka {
 	namespace {
-		// Phase calculation piece weights for tapered eval.
-		// Implementation is based on chessprogramming.org/Tapered_Eval
-		constexpr int p_phase[8] = { 0, 0, 0, 1, 1, 2, 4, 0 };
-		constexpr int MAX_PHASE = p_phase[PAWN] * 16 + p_phase[KNIGHT] * 4
-			+ p_phase[BISHOP] * 4 + p_phase[ROOK] * 4
-			+ p_phase[QUEEN] * 2;
+		#ifndef EVAL_TUNING
+		thread_local PawnHashTable pawn_table;
+		thread_local EvalCache eval_cache;
+		thread_local MaterialTable material_table;
 
+		#ifdef STATS_ENABLED
+		thread_local u64 num_lazy_queries = 0;
+		thread_local u64 num_lazy_skips = 0;
+		#endif
+		#endif
 
-		EvalScore PieceMobility(PieceType piece, Square sq, Bitboard occupation, Bitboard ally_occupation)
+		template<Side color>
+		force_inline void AddAttacks(AttackInfo& info, PieceType piece, Bitboard att)
 		{
-			EvalScore score;
-			Bitboard att = 0;
-			Bitboard legal_squares = ~ally_occupation; // pseudo legal. empty and opponent squares
-
-			switch (piece)
-			{
-			case KNIGHT:
-				att = attacks::KnightAttacks(sq) & legal_squares;
-				break;
-			case BISHOP:
-				att = attacks::BishopAttacks(sq, occupation) & legal_squares;
-				break;
-			case ROOK:
-				att = attacks::RookAttacks(sq, occupation) & legal_squares;
-				break;
-			case QUEEN:
-				att = attacks::QueenAttacks(sq, occupation) & legal_squares;
-				break;
-			default:
-				return score;
-			}
-
-			int num_attacks = bitboard::PopCount(att);
-			score.phase_score[MG] = g_eval_params.mobility_weights[MG][piece] * num_attacks;
-			score.phase_score[EG] = g_eval_params.mobility_weights[EG][piece] * num_attacks;
-			return score;
+			info.double_attacks[color] |= info.attacks[color][ALL_PIECES] & att;
+			info.attacks[color][ALL_PIECES] |= att;
+			info.attacks[color][piece] |= att;
 		}
 
 		template<Side color>
-		void EvaluatePawns(Bitboard ally_pawns, Bitboard opponent_pawns, int *scores)
+		void BuildAttacks(const GameState& pos, AttackInfo& info)
 		{
-			Bitboard pawns = ally_pawns;
-			int mg = 0, eg = 0;
+			Bitboard occupation = pos.Occupancy();
+			Bitboard legal_squares = ~pos.Pieces<color>(); // pseudo legal. empty and opponent squares
 
-			while (pawns) {
-				Square sq = bitboard::BitScanForward(pawns);
-
-				mg += g_eval_params.PST_mg[color][PAWN][sq];
-				eg += g_eval_params.PST_eg[color][PAWN][sq];
-
-				//// check for passed pawns
-				if ((attacks::PawnFrontSpan(sq, color) & opponent_pawns) == 0) {
-					int rank = GetRank(sq);
-					if constexpr (color == BLACK)
-						rank = 7 - rank;
-					mg += g_eval_params.passed_bonus[MG][rank];
-					eg += g_eval_params.passed_bonus[EG][rank];
-				}
+			for (PieceType p = PAWN; p <= KING; p++) {
+				info.attacks[color][p] = 0;
+				info.mobility[color][p] = 0;
+			}
+			info.attacks[color][ALL_PIECES] = 0;
+			info.double_attacks[color] = 0;
+
+			// pawns attack set-wise, a square attacked by two pawns is a double attack
+			Bitboard pawns = pos.Pieces<color, PAWN>();
+			Bitboard east_attacks = bitboard::StepOne<color == WHITE ? NORTHEAST : SOUTHEAST>(pawns);
+			Bitboard west_attacks = bitboard::StepOne<color == WHITE ? NORTHWEST : SOUTHWEST>(pawns);
+			AddAttacks<color>(info, PAWN, east_attacks);
+			AddAttacks<color>(info, PAWN, west_attacks);
+
+			Bitboard pieces = pos.Pieces<color>() ^ pawns;
+			#ifdef ANKA_SIMD_SLIDERS
+			// sliders are collected and their attacks generated 4 at a time
+			Square slider_squares[16];
+			PieceType slider_types[16];
+			int num_sliders = 0;
+			#endif
 
-				//// check for isolated pawns
-				int file = GetFile(sq);
-				if ((attacks::AdjacentFiles(file) & ally_pawns) == 0) {
-					mg -= g_eval_params.isolated_penalty[MG][file];
-					eg -= g_eval_params.isolated_penalty[EG][file];
+			while (pieces) {
+				Square sq = bitboard::BitScanForward(pieces);
+				PieceType piece = pos.GetPiece(sq);
+				Bitboard att;
+
+				switch (piece)
+				{
+				case KNIGHT:
+					att = attacks::KnightAttacks(sq);
+					break;
+				#ifdef ANKA_SIMD_SLIDERS
+				case BISHOP:
+				case ROOK:
+				case QUEEN:
+					slider_squares[num_sliders] = sq;
+					slider_types[num_sliders++] = piece;
+					pieces &= pieces - 1;
+					continue;
+				#else
+				case BISHOP:
+					att = attacks::BishopAttacks(sq, occupation);
+					break;
+				case ROOK:
+					att = attacks::RookAttacks(sq, occupation);
+					break;
+				case QUEEN:
+					att = attacks::QueenAttacks(sq, occupation);
+					break;
+				#endif
+				default:
+					att = attacks::KingAttacks(sq);
+					break;
 				}
 
-				pawns &= pawns - 1;
+				AddAttacks<color>(info, piece, att);
+				info.mobility[color][piece] += bitboard::PopCount(att & legal_squares);
+				pieces &= pieces - 1;
 			}
 
-			if constexpr (color == WHITE) {
-				scores[0] += mg;
-				scores[1] += eg;
-			}
-			else {
-				scores[0] -= mg;
-				scores[1] -= eg;
+			#ifdef ANKA_SIMD_SLIDERS
+			for (int i = 0; i < num_sliders; i += 4) {
+				Bitboard slider_attacks[4];
+				int count = Min(4, num_sliders - i);
+				attacks::SliderAttacksX4(&slider_squares[i], &slider_types[i], count, occupation, slider_attacks);
+				for (int j = 0; j < count; j++) {
+					AddAttacks<color>(info, slider_types[i + j], slider_attacks[j]);
+					info.mobility[color][slider_types[i + j]] += bitboard::PopCount(slider_attacks[j] & legal_squares);
+				}
 			}
+			#endif
 		}
 
-
+		// Pawn structure of one side
+		struct PawnSets {
+			Bitboard passed;    // no opponent pawns in front on the same or adjacent files
+			Bitboard isolated;  // no own pawns on adjacent files
+			Bitboard doubled;   // another own pawn in front on the same file
+			Bitboard backward;  // stop square attacked by an opponent pawn and no own pawn beside or behind on adjacent files
+			Bitboard connected; // defended by an own pawn or has an own pawn beside it
+		};
+
+		// Computes the pawn sets with fills over the whole board instead of per pawn lookups.
+		// Doubled, backward and connected pawns aren't scored yet.
 		template<Side color>
-		int EvaluatePieces(const GameState& pos, int* scores)
+		PawnSets BuildPawnSets(Bitboard ally_pawns, Bitboard opponent_pawns)
 		{
+			constexpr int up = color == WHITE ? NORTH : SOUTH;
+			constexpr int down = color == WHITE ? SOUTH : NORTH;
+			using bitboard::StepOne;
+			using bitboard::Fill;
+
+			Bitboard ally_attacks = StepOne<up + EAST>(ally_pawns) | StepOne<up + WEST>(ally_pawns);
+			Bitboard opponent_attacks = StepOne<down + EAST>(opponent_pawns) | StepOne<down + WEST>(opponent_pawns);
+
+			// squares in front of the opponent pawns, from the opponent's point of view, and the adjacent files
+			Bitboard opponent_front = Fill<down>(StepOne<down>(opponent_pawns));
+			Bitboard opponent_span = opponent_front | StepOne<EAST>(opponent_front) | StepOne<WEST>(opponent_front);
+
+			Bitboard ally_files = bitboard::FileFill(ally_pawns);
+			Bitboard attack_span = Fill<up>(ally_attacks); // squares own pawns attack or can attack after advancing
+
+			PawnSets sets;
+			sets.passed = ally_pawns & ~opponent_span;
+			sets.isolated = ally_pawns & ~(StepOne<EAST>(ally_files) | StepOne<WEST>(ally_files));
+			sets.doubled = ally_pawns & Fill<down>(StepOne<down>(ally_pawns));
+			sets.backward = StepOne<down>(StepOne<up>(ally_pawns) & opponent_attacks & ~attack_span);
+			sets.connected = ally_pawns & (ally_attacks | StepOne<EAST>(ally_pawns) | StepOne<WEST>(ally_pawns));
+			return sets;
+		}
 
-			int phase_change = 0;
-			int mg = 0, eg = 0;
-			Bitboard pieces = pos.Pieces<color>() ^ pos.Pieces<color, PAWN>();
-			while (pieces) {
-				Square sq = bitboard::BitScanForward(pieces);
-				auto piece = pos.GetPiece(sq);
-				phase_change += p_phase[piece];
+		// Per pawn version of BuildPawnSets, used to verify it
+		PawnSets BuildPawnSetsSlow(Bitboard ally_pawns, Bitboard opponent_pawns, Side color)
+		{
+			PawnSets sets{};
+			Bitboard pawns = ally_pawns;
+			while (pawns) {
+				Square sq = bitboard::BitScanForward(pawns);
+				Bitboard bb = C64(1) << sq;
+				int file = GetFile(sq);
+				Bitboard front_span = attacks::PawnFrontSpan(sq, color);
+				Square stop = color == WHITE ? sq + 8 : sq - 8;
+
+				if ((front_span & opponent_pawns) == 0)
+					sets.passed |= bb;
+				if ((attacks::AdjacentFiles(file) & ally_pawns) == 0)
+					sets.isolated |= bb;
+				if (front_span & attacks::FileMasks(file) & ally_pawns)
+					sets.doubled |= bb;
+				if (stop >= A1 && stop <= H8 && (attacks::PawnAttacks(stop, color) & opponent_pawns)
+					&& (attacks::AdjacentFiles(file) & ally_pawns & ~front_span) == 0)
+					sets.backward |= bb;
+				if ((attacks::PawnAttacks(sq, !color) & ally_pawns)
+					|| ((bitboard::StepOne<EAST>(bb) | bitboard::StepOne<WEST>(bb)) & ally_pawns))
+					sets.connected |= bb;
 
-				mg += g_eval_params.PST_mg[color][piece][sq];
-				eg += g_eval_params.PST_eg[color][piece][sq];
+				pawns &= pawns - 1;
+			}
 
-				EvalScore piece_mobility = PieceMobility(piece, sq, pos.Occupancy(), pos.Pieces<color>());
-				mg += piece_mobility.phase_score[MG];
-				eg += piece_mobility.phase_score[EG];
+			return sets;
+		}
 
+		force_inline bool SamePawnSets(const PawnSets& a, const PawnSets& b)
+		{
+			return a.passed == b.passed && a.isolated == b.isolated && a.doubled == b.doubled
+				&& a.backward == b.backward && a.connected == b.connected;
+		}
 
-				pieces &= pieces - 1;
+		template<Side color>
+		void EvaluatePawns(Bitboard ally_pawns, Bitboard opponent_pawns, Score& score, Bitboard& passed_pawns)
+		{
+			PawnSets sets = BuildPawnSets<color>(ally_pawns, opponent_pawns);
+			ANKA_ASSERT(SamePawnSets(sets, BuildPawnSetsSlow(ally_pawns, opponent_pawns, color)));
+
+			passed_pawns = sets.passed;
+			Score result{};
+
+			// passed pawn bonus by relative rank
+			for (int rank = RANK_ONE; rank <= RANK_EIGHT && sets.passed; rank++) {
+				Bitboard rank_mask = C64(0xFF) << (8 * (color == WHITE ? rank : 7 - rank));
+				int count = bitboard::PopCount(sets.passed & rank_mask);
+				result += g_eval_params.passed[rank] * count;
+				TRACE(Add(EvalTrace::passed_bonus, rank, color == WHITE ? count : -count));
 			}
 
-			if constexpr (color == WHITE) {
-				scores[0] += mg;
-				scores[1] += eg;
-			}
-			else {
-				scores[0] -= mg;
-				scores[1] -= eg;
+			// isolated pawn penalty by file
+			for (int file = FILE_A; file <= FILE_H && sets.isolated; file++) {
+				int count = bitboard::PopCount(sets.isolated & attacks::FileMasks(file));
+				result -= g_eval_params.isolated[file] * count;
+				TRACE(Add(EvalTrace::isolated_penalty, file, color == WHITE ? -count : count));
 			}
 
-			return phase_change;
+			if constexpr (color == WHITE)
+				score += result;
+			else
+				score -= result;
 		}
-	}
 
-	// Evaluates the position from side to play's perspective.
-	// Returns a score in centipawns.
-    int GameState::ClassicalEvaluation() const
-    {
-		// Insufficient Material Draws: KvK, KNvK, KBvK
-		if (m_piecesBB[PAWN] == 0) {
-			int n_total = bitboard::PopCount(m_occupation);
-			if (n_total == 2 || (n_total == 3 && (m_piecesBB[KNIGHT] | m_piecesBB[BISHOP])))
-				return 0;
-		}
-
-		int scores[NUM_PHASES]{};
-		int phase = MAX_PHASE;
 
-		Bitboard w_pawns = Pieces<WHITE, PAWN>();
-		Bitboard b_pawns = Pieces<BLACK, PAWN>();
+		#ifndef EVAL_TUNING
+		// Returns the pawn structure terms of the position, evaluating them on a pawn hash table miss
+		const PawnEntry* ProbePawns(const GameState& pos)
+		{
+			bool hit;
+			PawnEntry* entry = pawn_table.Probe(pos.PawnKey(), hit);
+			if (!hit) {
+				Bitboard w_pawns = pos.Pieces<WHITE, PAWN>();
+				Bitboard b_pawns = pos.Pieces<BLACK, PAWN>();
+
+				entry->score = Score();
+				EvaluatePawns<WHITE>(w_pawns, b_pawns, entry->score, entry->passed_pawns[WHITE]);
+				EvaluatePawns<BLACK>(b_pawns, w_pawns, entry->score, entry->passed_pawns[BLACK]);
+				entry->key = pos.PawnKey();
+			}
 
-		EvaluatePawns<WHITE>(w_pawns, b_pawns, scores);
-		EvaluatePawns<BLACK>(b_pawns, w_pawns, scores);
+			return entry;
+		}
+		#endif
 
+		// Pawn structure terms of the position, white - black
+		Score PawnScore(const GameState& pos)
+		{
+		#ifdef EVAL_TUNING
+			Score score{};
+			Bitboard passed_pawns[NUM_SIDES];
+			Bitboard w_pawns = pos.Pieces<WHITE, PAWN>();
+			Bitboard b_pawns = pos.Pieces<BLACK, PAWN>();
+
+			EvaluatePawns<WHITE>(w_pawns, b_pawns, score, passed_pawns[WHITE]);
+			EvaluatePawns<BLACK>(b_pawns, w_pawns, score, passed_pawns[BLACK]);
+			return score;
+		#else
+			return ProbePawns(pos)->score;
+		#endif
+		}
 
-		phase -= EvaluatePieces<WHITE>(*this, scores);
-		phase -= EvaluatePieces<BLACK>(*this, scores);
-	
 
+		template<Side color>
+		void EvaluateMobility(const AttackInfo& info, Score& score)
+		{
+			Score result{};
+			for (PieceType piece = KNIGHT; piece <= QUEEN; piece++) {
+				result += g_eval_params.mobility[piece] * info.mobility[color][piece];
+				TRACE(Add(EvalTrace::mobility_weights, piece, color == WHITE ? info.mobility[color][piece] : -info.mobility[color][piece]));
+			}
 
-		// bishop pair bonus
-		int n_white_bishops = bitboard::PopCount(Pieces<WHITE, BISHOP>());
-		int n_black_bishops= bitboard::PopCount(Pieces<BLACK, BISHOP>());
-		if (n_white_bishops > 1) {
-			scores[MG] += g_eval_params.bishop_pair_bonus[MG];
-			scores[EG] += g_eval_params.bishop_pair_bonus[EG];
+			if constexpr (color == WHITE)
+				score += result;
+			else
+				score -= result;
 		}
-		if (n_black_bishops > 1) {
-			scores[MG] -= g_eval_params.bishop_pair_bonus[MG];
-			scores[EG] -= g_eval_params.bishop_pair_bonus[EG];
+
+		// Mobility terms of the position, white - black
+		Score MobilityScore(const GameState& pos)
+		{
+			AttackInfo attack_info;
+			attack_info.Build(pos);
+
+			Score score{};
+			EvaluateMobility<WHITE>(attack_info, score);
+			EvaluateMobility<BLACK>(attack_info, score);
+			return score;
 		}
 
+		// Adds the pawn, mobility and imbalance terms to the material and PST score 'score', scales and
+		// tapers it. Returns the evaluation from side to play's perspective.
+		int EvaluateTerms(const GameState& pos, const MaterialEntry* material_entry, Score score)
+		{
+			score += PawnScore(pos);
+			score += MobilityScore(pos);
+			score += material_entry->imbalance;
+
+			// scale down the endgame score of drawish material
+			int eg = score.Eg();
+			Side strong_side = eg > 0 ? WHITE : BLACK;
+			int scale_factor = material_entry->ScaleFactor(pos, strong_side);
+			score = Score(score.Mg(), eg * scale_factor / SCALE_NORMAL);
+			TRACE(scale = scale_factor);
+			TRACE(phase = material_entry->phase);
+
+			// Interpolate the score between middle game and end game.
+			// (phase = 0 at the beginning and phase = 256 at the endgame.)
+			int result = score.Taper(material_entry->phase);
+
+			if (pos.SideToPlay() == WHITE) {
+				result += g_eval_params.tempo_bonus;
+			}
+			else {
+				result -= g_eval_params.tempo_bonus;
+				result = (-result);
+			}
 
+			return result;
+		}
+	}
 
-		// Map phase to [0-256]
-		phase = ((phase << 8) + (MAX_PHASE >> 1)) / MAX_PHASE; 	// (phase * 256 + (MAX_PHASE / 2)) / MAX_PHASE
+	int CheckPawnSets(const GameState& pos)
+	{
+		Bitboard w_pawns = pos.Pieces<WHITE, PAWN>();
+		Bitboard b_pawns = pos.Pieces<BLACK, PAWN>();
+
+		int mismatches = 0;
+		if (!SamePawnSets(BuildPawnSets<WHITE>(w_pawns, b_pawns), BuildPawnSetsSlow(w_pawns, b_pawns, WHITE)))
+			mismatches++;
+		if (!SamePawnSets(BuildPawnSets<BLACK>(b_pawns, w_pawns), BuildPawnSetsSlow(b_pawns, w_pawns, BLACK)))
+			mismatches++;
+		return mismatches;
+	}
 
-		// Interpolate the score between middle game and end game.
-		// (phase = 0 at the beginning and phase = 256 at the endgame.)
-		int result = ((scores[MG] * (256 - phase)) + (scores[EG] * phase)) >> 8;
+	void AttackInfo::Build(const GameState& pos)
+	{
+		BuildAttacks<WHITE>(pos, *this);
+		BuildAttacks<BLACK>(pos, *this);
+	}
 
+	void GameState::CalculatePSQT(Score& psqt, int& phase_material) const
+	{
+		psqt = Score();
+		phase_material = 0;
 
+		for (Side color = WHITE; color < NUM_SIDES; color++) {
+			Bitboard pieces = m_piecesBB[color];
+			while (pieces) {
+				Square sq = bitboard::BitScanForward(pieces);
+				PieceType piece = m_board[sq];
+				psqt += g_eval_params.PST[color][piece][sq];
+				phase_material += p_phase[piece];
+				TRACE(Add(EvalTrace::piece_values, piece, color == WHITE ? 1 : -1));
+				TRACE(Add(EvalTrace::pst_tables[piece], color == WHITE ? sq ^ 56 : sq, color == WHITE ? 1 : -1));
+				pieces &= pieces - 1;
+			}
+		}
+	}
 
-		if (m_side == WHITE) {
-			result += g_eval_params.tempo_bonus;
+	// Evaluates the position from side to play's perspective.
+	// Returns a score in centipawns.
+    int GameState::ClassicalEvaluation() const
+    {
+		return ClassicalEvaluation(-ANKA_INFINITE, ANKA_INFINITE);
+    }
 
+	// Lazy evaluation. The material and PST estimate is returned as soon as it is more than
+	// the lazy margin outside the (alpha, beta) window, which skips the pawn and mobility terms.
+	// The estimate isn't cached since it is only a bound for that window.
+	int GameState::ClassicalEvaluation([[maybe_unused]] int alpha, [[maybe_unused]] int beta) const
+	{
+#ifndef EVAL_TUNING
+		int cached_eval;
+		if (eval_cache.Probe(m_zobrist_key, cached_eval))
+			return cached_eval;
+
+		const MaterialEntry* material_entry = material_table.Probe(*this);
+#else
+		// the tuner changes the parameters after the positions are loaded
+		MaterialEntry material;
+		EvaluateMaterial(*this, material);
+		const MaterialEntry* material_entry = &material;
+#endif
+
+		// known endgames, including insufficient material draws
+		if (material_entry->eval_func) {
+			TRACE(fixed = true);
+			return material_entry->eval_func(*this, material_entry->strong_side);
 		}
-		if (m_side == BLACK) {
-			result -= g_eval_params.tempo_bonus;
-			result = (-result);
+
+		Score score;
+#ifdef EVAL_TUNING
+		int phase_material;
+		CalculatePSQT(score, phase_material);
+#else
+		score = m_psqt;
+
+		if (alpha > -ANKA_INFINITE || beta < ANKA_INFINITE) {
+			STATS(num_lazy_queries++);
+			int estimate = (score + material_entry->imbalance).Taper(material_entry->phase);
+			if (m_side == BLACK)
+				estimate = -estimate;
+			estimate += g_eval_params.tempo_bonus;
+
+			int margin = g_lazy_eval_margin;
+			if (estimate + margin <= alpha || estimate - margin >= beta) {
+				STATS(num_lazy_skips++);
+				return estimate;
+			}
 		}
+#endif
 
+		int result = EvaluateTerms(*this, material_entry, score);
+
+#ifndef EVAL_TUNING
+		eval_cache.Store(m_zobrist_key, result);
+#endif
 
 		return result;
     }
 
+	#ifdef EVAL_TUNING
+	int TraceEvaluation(const GameState& pos, EvalTrace& trace)
+	{
+		trace = EvalTrace{};
+		g_eval_trace = &trace;
+		int eval = pos.ClassicalEvaluation();
+		g_eval_trace = nullptr;
+
+		trace.tempo = pos.SideToPlay() == WHITE ? 1 : -1;
+		if (trace.fixed) {
+			// the material terms are traced before the endgame is recognized
+			memset(trace.coefficients, 0, sizeof(trace.coefficients));
+			trace.fixed_eval = trace.tempo * eval;
+		}
+		return eval;
+	}
+	#endif
+
+	void ClearEvalCache()
+	{
+	#ifndef EVAL_TUNING
+		eval_cache.Clear();
+	#endif
+	}
 
+	#if defined(STATS_ENABLED) && !defined(EVAL_TUNING)
+	void PrintEvalStatistics()
+	{
+		pawn_table.PrintStatistics();
+		eval_cache.PrintStatistics();
+		material_table.PrintStatistics();
+
+		printf("\nLAZY EVALUATION STATISTICS\n");
+		printf("Skip rate: %.4f (%" PRIu64 " / %" PRIu64 ")\n",
+			num_lazy_skips / static_cast<double>(num_lazy_queries), num_lazy_skips, num_lazy_queries);
+	}
+	#endif
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "endgame.hpp"
+#include "evaluation.hpp"
+#include "hash.hpp"
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+
+namespace anka {
+	namespace {
+		// sorted by key after InitEndgames
+		constexpr int MAX_ENDGAMES = 256;
+		Endgame endgames[MAX_ENDGAMES];
+		int num_endgames = 0;
+
+		constexpr Bitboard DARK_SQUARES = C64(0xAA55AA55AA55AA55);
+
+		force_inline int Distance(Square sq1, Square sq2)
+		{
+			return Max(abs(GetRank(sq1) - GetRank(sq2)), abs(GetFile(sq1) - GetFile(sq2)));
+		}
+
+		// 0 in the center, 120 in the corners
+		force_inline int PushToEdge(Square sq)
+		{
+			int file_dist = Max(3 - GetFile(sq), GetFile(sq) - 4);
+			int rank_dist = Max(3 - GetRank(sq), GetRank(sq) - 4);
+			return 20 * (file_dist + rank_dist);
+		}
+
+		force_inline int PushClose(Square sq1, Square sq2)
+		{
+			return 140 - 20 * Distance(sq1, sq2);
+		}
+
+		force_inline Bitboard SidePieces(const GameState& pos, Side side)
+		{
+			return side == WHITE ? pos.WhitePieces() : pos.BlackPieces();
+		}
+
+		force_inline Square KingSquare(const GameState& pos, Side side)
+		{
+			return bitboard::BitScanForward(pos.Kings() & SidePieces(pos, side));
+		}
+
+		force_inline int FromStrongSide(const GameState& pos, Side strong_side, int score)
+		{
+			score = Min(score, UPPER_MATE_THRESHOLD - 1);
+			return pos.SideToPlay() == strong_side ? score : -score;
+		}
+
+		/* Material key of an endgame code like "KBNK". The pieces after the second king belong to the weak side.
+		* The key is the same as the one GameState maintains for these piece counts.
+		*/
+		u64 MaterialKeyFromCode(const char* code, Side strong_side)
+		{
+			int counts[NUM_SIDES][8]{};
+			Side side = strong_side;
+			for (const char* c = code + 1; *c; c++) {
+				if (*c == 'K')
+					side ^= 1;
+				else
+					counts[side][CharToPieceType(*c)]++;
+			}
+
+			u64 key = C64(0);
+			for (Side color = WHITE; color <= BLACK; color++) {
+				for (PieceType t = PAWN; t < KING; t++) {
+					for (int i = 0; i < counts[color][t]; i++) {
+						key ^= zobrist_keys::piece_keys[color][t - 2][i];
+					}
+				}
+			}
+
+			return key;
+		}
+
+		void AddEndgame(const char* code, EndgameEval eval, EndgameScale scale = nullptr)
+		{
+			for (Side strong_side = WHITE; strong_side <= BLACK; strong_side++) {
+				ANKA_ASSERT(num_endgames < MAX_ENDGAMES);
+				endgames[num_endgames++] = { MaterialKeyFromCode(code, strong_side), eval, scale, strong_side };
+			}
+		}
+
+		void AddScale(const char* code, EndgameScale scale)
+		{
+			AddEndgame(code, nullptr, scale);
+		}
+	}
+
+	namespace endgame {
+		int EvaluateDraw(const GameState& /*pos*/, Side /*strong_side*/)
+		{
+			return 0;
+		}
+
+		// Drives the lone king to the edge and brings the strong king closer
+		int EvaluateKXK(const GameState& pos, Side strong_side)
+		{
+			Square strong_king = KingSquare(pos, strong_side);
+			Square weak_king = KingSquare(pos, strong_side ^ 1);
+			Bitboard strong_pieces = SidePieces(pos, strong_side);
+
+			// Bishops on squares of one color can't mate. The material key doesn't know the square colors,
+			// so KBBK and similar material with same colored bishops is routed here and detected now.
+			Bitboard strong_bishops = pos.Bishops() & strong_pieces;
+			bool only_bishops = (strong_pieces & ~pos.Kings()) == strong_bishops;
+			if (only_bishops && ((strong_bishops & DARK_SQUARES) == 0 || (strong_bishops & ~DARK_SQUARES) == 0))
+				return 0;
+
+			int score = KNOWN_WIN + PushToEdge(weak_king) + PushClose(strong_king, weak_king);
+			while (strong_pieces) {
+				Square sq = bitboard::BitScanForward(strong_pieces);
+				score += g_eval_params.piece_values[EG][pos.GetPiece(sq)]; // king value is 0
+				strong_pieces &= strong_pieces - 1;
+			}
+
+			return FromStrongSide(pos, strong_side, score);
+		}
+
+		// The lone king can only be mated in a corner of the bishop's color
+		int EvaluateKBNK(const GameState& pos, Side strong_side)
+		{
+			Square strong_king = KingSquare(pos, strong_side);
+			Square weak_king = KingSquare(pos, strong_side ^ 1);
+			bool dark_bishop = (pos.Bishops() & DARK_SQUARES) != 0;
+
+			Square corner1 = dark_bishop ? A1 : A8;
+			Square corner2 = dark_bishop ? H8 : H1;
+			int corner_dist = Min(Distance(weak_king, corner1), Distance(weak_king, corner2));
+
+			int score = KNOWN_WIN + g_eval_params.piece_values[EG][BISHOP] + g_eval_params.piece_values[EG][KNIGHT]
+				+ 30 * (7 - corner_dist) + PushClose(strong_king, weak_king);
+
+			return FromStrongSide(pos, strong_side, score);
+		}
+
+		// Rook pawns on one file can't be won if the lone king reaches the promotion corner
+		int ScaleKPsK(const GameState& pos, Side strong_side)
+		{
+			Bitboard pawns = pos.Pawns();
+			if ((pawns & SidePieces(pos, strong_side)) == 0)
+				return SCALE_NORMAL;
+
+			Bitboard a_file = attacks::FileMasks(FILE_A);
+			Bitboard h_file = attacks::FileMasks(FILE_H);
+			if ((pawns & ~a_file) && (pawns & ~h_file))
+				return SCALE_NORMAL;
+
+			File file = (pawns & a_file) ? FILE_A : FILE_H;
+			Square queening_sq = RankFileToSquare(strong_side == WHITE ? RANK_EIGHT : RANK_ONE, file);
+			if (Distance(KingSquare(pos, strong_side ^ 1), queening_sq) <= 1)
+				return SCALE_DRAW;
+
+			return SCALE_NORMAL;
+		}
+
+		// Only called when each side has a bishop and pawns and nothing else
+		int ScaleOppositeBishops(const GameState& pos, Side /*strong_side*/)
+		{
+			Bitboard dark_bishops = pos.Bishops() & DARK_SQUARES;
+			if (dark_bishops == 0 || dark_bishops == pos.Bishops())
+				return SCALE_NORMAL;
+
+			return SCALE_NORMAL / 2;
+		}
+	}
+
+	void InitEndgames()
+	{
+		num_endgames = 0;
+
+		// insufficient material
+		AddEndgame("KK", endgame::EvaluateDraw);
+		AddEndgame("KNK", endgame::EvaluateDraw);
+		AddEndgame("KBK", endgame::EvaluateDraw);
+		AddEndgame("KNNK", endgame::EvaluateDraw);
+
+		// mating material vs lone king. EvaluateMaterial also routes other winning material there
+		AddEndgame("KQK", endgame::EvaluateKXK);
+		AddEndgame("KRK", endgame::EvaluateKXK);
+		AddEndgame("KBBK", endgame::EvaluateKXK);
+		AddEndgame("KQQK", endgame::EvaluateKXK);
+		AddEndgame("KQRK", endgame::EvaluateKXK);
+		AddEndgame("KRRK", endgame::EvaluateKXK);
+		AddEndgame("KBNK", endgame::EvaluateKBNK);
+
+		// pawns vs lone king, and a bishop and pawns for each side
+		for (int pawns = 1; pawns <= 8; pawns++) {
+			AddScale(("K" + std::string(pawns, 'P') + "K").c_str(), endgame::ScaleKPsK);
+		}
+		for (int strong_pawns = 0; strong_pawns <= 8; strong_pawns++) {
+			for (int weak_pawns = 0; weak_pawns <= strong_pawns; weak_pawns++) {
+				std::string code = "KB" + std::string(strong_pawns, 'P') + "KB" + std::string(weak_pawns, 'P');
+				AddScale(code.c_str(), endgame::ScaleOppositeBishops);
+			}
+		}
+
+		std::sort(endgames, endgames + num_endgames, [](const Endgame& a, const Endgame& b) {
+			return a.key < b.key;
+		});
+	}
+
+	const Endgame* FindEndgame(u64 material_key)
+	{
+		const Endgame* begin = endgames;
+		const Endgame* end = endgames + num_endgames;
+		const Endgame* it = std::lower_bound(begin, end, material_key, [](const Endgame& e, u64 key) {
+			return e.key < key;
+		});
+
+		return it != end && it->key == material_key ? it : nullptr;
+	}
+}
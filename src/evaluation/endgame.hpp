@@ -0,0 +1,41 @@
+#pragma once
+#include "core.hpp"
+#include "boarddefs.hpp"
+#include "gamestate.hpp"
+
+namespace anka {
+	inline constexpr int KNOWN_WIN = 10000;
+
+	// endgame scale factors are applied to the endgame score, out of SCALE_NORMAL
+	inline constexpr int SCALE_NORMAL = 64;
+	inline constexpr int SCALE_DRAW = 0;
+
+	// Evaluates a known endgame. Returns a score from the side to move's perspective
+	using EndgameEval = int (*)(const GameState& pos, Side strong_side);
+
+	// Returns the scale factor of 'strong_side's endgame score
+	using EndgameScale = int (*)(const GameState& pos, Side strong_side);
+
+	namespace endgame {
+		int EvaluateDraw(const GameState& pos, Side strong_side);
+		int EvaluateKXK(const GameState& pos, Side strong_side); // mating material vs lone king, a draw with bishops of one color
+		int EvaluateKBNK(const GameState& pos, Side strong_side);
+
+		int ScaleKPsK(const GameState& pos, Side strong_side); // rook pawns vs lone king
+		int ScaleOppositeBishops(const GameState& pos, Side strong_side);
+	}
+
+	// An endgame recognized by its material key. It has an evaluation function, a scale function or both.
+	struct Endgame {
+		u64 key;
+		EndgameEval eval;
+		EndgameScale scale;
+		Side strong_side; // for eval
+	};
+
+	// Builds the table of endgames that are recognized by their material key. Call after InitZobristKeys
+	void InitEndgames();
+
+	// Returns the endgame with 'material_key', nullptr if there isn't one
+	const Endgame* FindEndgame(u64 material_key);
+}
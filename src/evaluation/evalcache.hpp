@@ -0,0 +1,56 @@
+#pragma once
+#include "core.hpp"
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+namespace anka {
+	/* Maps position keys to static evaluations. The same position is evaluated many times
+	* across iterations, null move searches and quiescence re-entries.
+	* Each entry is 8 bytes: the upper 48 bits of the key and the 16-bit evaluation.
+	* Each search thread has its own cache, so there is no locking.
+	*/
+	class EvalCache {
+	public:
+		static constexpr size_t NUM_ENTRIES = 65536; // 512 KiB
+
+		force_inline bool Probe(u64 pos_key, int& eval)
+		{
+			u64 data = m_entries[pos_key & (NUM_ENTRIES - 1)];
+			bool hit = ((data ^ pos_key) & key_mask) == 0;
+			STATS(m_num_queries++);
+			STATS(m_num_hits += hit);
+			eval = static_cast<i16>(data & ~key_mask);
+			return hit;
+		}
+
+		force_inline void Store(u64 pos_key, int eval)
+		{
+			m_entries[pos_key & (NUM_ENTRIES - 1)] = (pos_key & key_mask) | static_cast<u16>(eval);
+		}
+
+		void Clear()
+		{
+			memset(m_entries, 0, sizeof(m_entries));
+			STATS(m_num_queries = 0);
+			STATS(m_num_hits = 0);
+		}
+
+		#ifdef STATS_ENABLED
+		void PrintStatistics() const
+		{
+			printf("\nEVAL CACHE STATISTICS\n");
+			printf("Hit rate: %.4f (%" PRIu64 " / %" PRIu64 ")\n",
+				m_num_hits / static_cast<double>(m_num_queries), m_num_hits, m_num_queries);
+		}
+		#endif
+	private:
+		static constexpr u64 key_mask = ~C64(0xFFFF);
+		u64 m_entries[NUM_ENTRIES]{};
+
+		#ifdef STATS_ENABLED
+		u64 m_num_queries = 0;
+		u64 m_num_hits = 0;
+		#endif
+	};
+}
@@ -1,202 +1,455 @@
-//#define EVAL_TUNING
-//#define _USE_MATH_DEFINES
-//
-//#include "evaluation.hpp"
-//#include "mainloop.hpp"
-//#include "timer.hpp"
-//#include "util.hpp"
-//#include <numeric>
-//#include <math.h>
-//#include <float.h>
-//#include <algorithm>
-//
-//
-//
-//static constexpr double K = 1.00;
-//static constexpr double SIG_CONSTANT = (-K / 400.0);
-//
-//typedef std::array<int, anka::EvalParams::NUM_PARAMS> Solution;
-//
-//void Init(anka::RNG& rng)
-//{
-//	using namespace anka;
-//	anka::InitZobristKeys(rng);
-//	anka::attacks::InitAttacks();
-//	anka::g_eval_params.InitPST();
-//	anka::g_trans_table.Init(EngineSettings::DEFAULT_HASH_SIZE);
-//}
-//
-//namespace anka {
-//	// Global structures
-//	TranspositionTable g_trans_table;
-//	EvalParams g_eval_params;
-//}
-//
-//// White respective evaluation of the position
-//double Evaluate(const anka::GameState& pos)
-//{
-//	double eval = static_cast<double>(pos.ClassicalEvaluation());
-//	return pos.SideToPlay() == anka::WHITE ? eval : -eval;
-//}
-//
-//
-//double Sigmoid(double eval) 
-//{
-//	return 1.0 / (1.0 + pow(10.0, SIG_CONSTANT * eval));
-//}
-//
-//
-//double ResultStrToScore(const char* result_str)
-//{
-//	double result = 0;
-//	if (strcmp("1/2-1/2", result_str) == 0)
-//		return 0.5;
-//	else if (strcmp("1-0", result_str) == 0)
-//		return 1;
-//	else if (strcmp("0-1", result_str) == 0)
-//		return 0;
-//	else {
-//		fprintf(stderr, "Invalid result string\n");
-//		exit(EXIT_FAILURE);
-//	}
-//
-//}
-//
-//
-//template <int batch_size>
-//struct Batch {
-//	std::vector<anka::GameState> positions;
-//	std::vector<double> labels;
-//
-//	Batch()
-//	{
-//		positions.resize(batch_size);
-//		labels.resize(batch_size);
-//	}
-//
-//
-//	bool Read(FILE* file_stream)
-//	{
-//		constexpr int BUFFER_SIZE = 4096;
-//		char buffer[BUFFER_SIZE];
-//
-//		for (int i = 0; i < batch_size; i++) {
-//			if (fgets(buffer, BUFFER_SIZE, file_stream) == NULL) {
-//				fprintf(stderr, "Failed to read position number %d.", i + 1);
-//				fclose(file_stream);
-//				return false;
-//			}
-//
-//			char* fen = strtok(buffer, "\"");
-//			char* result_str = strtok(NULL, "\"");
-//			*(result_str - 5) = '\0';
-//			double game_result = ResultStrToScore(result_str);
-//
-//			if (!positions[i].LoadPosition(fen)) {
-//				fprintf(stderr, "Failed to load position: %s\n", fen);
-//				fclose(file_stream);
-//				return false;
-//			}
-//			labels[i] = game_result;
-//		}
-//
-//		return true;
-//	}
-//
-//	double MSE(const Solution &solution)
-//	{
-//		anka::g_eval_params.UpdateParams(solution);
-//		double mse = 0.0;
-//		for (int i = 0; i < batch_size; i++) {
-//			double sigmoid = Sigmoid(Evaluate(positions[i]));
-//			double pos_error = labels[i] - sigmoid;
-//			mse += (pos_error * pos_error) / batch_size;
-//		}
-//		return mse;
-//	}
-//};
-//
-//
-//template <int batch_size>
-//static void GreedyLocalSearch(anka::RNG& rng, Batch<batch_size>* batch, int num_iterations = 1000000)
-//{
-//	using namespace anka;
-//	
-//	Solution best_sol;
-//	g_eval_params.FlattenParams(best_sol);
-//	double best_cost = batch->MSE(best_sol);
-//
-//	printf("Itr 0 MSE: %f RMSE: %f\n", best_cost, sqrt(best_cost));
-//	std::uniform_int_distribution<> step_dist(-2, 2);
-//	int step = 0;
-//	int itr = 0;
-//
-//	while (itr < num_iterations) {
-//		itr++;
-//		int rand_param_index = rng.randint(0, EvalParams::NUM_PARAMS);
-//		do {
-//			step = step_dist(rng);
-//		} while (step == 0);
-//
-//		best_sol[rand_param_index] += step;
-//		double cost = batch->MSE(best_sol);
-//		
-//		if (cost < best_cost) {
-//			best_cost = cost;
-//		}
-//		else {
-//			best_sol[rand_param_index] -= step;
-//		}
-//
-//
-//		if (itr % 1000 == 0) {
-//			printf("Itr %d MSE: %f RMSE: %f\n", itr, best_cost, sqrt(best_cost));
-//			char filename[128];
-//			sprintf(filename, "best_params/best_params725K_LOCAL%d.txt", itr);
-//			anka::g_eval_params.UpdateParams(best_sol);
-//			anka::g_eval_params.WriteParamsToFile(filename);
-//		}
-//		else if (itr % 50 == 0) {
-//			printf("Itr %d MSE: %f RMSE: %f\n", itr, best_cost, sqrt(best_cost));
-//		}
-//
-//	}
-//
-//	printf("\nDone. MSE: %f RMSE: %f\n", best_cost, sqrt(best_cost));
-//	g_eval_params.UpdateParams(best_sol);
-//	g_eval_params.WriteParamsToFile("best_params/best_params725K_LOCAL.txt");
-//}
-//
-//
-//
-//int main()
-//{
-//	anka::RNG rng;
-//	Init(rng);
-//
-//	constexpr int TRAINING_DATA_SIZE = 725'000;
-//	const char* filename_training = R"(quiet-labeled.epd)";
-//
-//	FILE* training_file = fopen(filename_training, "r");
-//	if (training_file == NULL) {
-//		fprintf(stderr, "Failed to open %s", filename_training);
-//		return EXIT_FAILURE;
-//	}
-//
-//	Batch<TRAINING_DATA_SIZE> training_set;
-//	
-//	printf("Reading the dataset...\n");
-//	if (!training_set.Read(training_file)) {
-//			fclose(training_file);
-//			return EXIT_FAILURE;
-//	}
-//	fclose(training_file);
-//
-//
-//	anka::Timer t;
-//	printf("Starting Optimization...\n");	
-//	GreedyLocalSearch<TRAINING_DATA_SIZE>(rng, &training_set);
-//
-//
-//	return 0;
-//}
\ No newline at end of file
+#include "evaluation.hpp"
+#include "attacks.hpp"
+#include "endgame.hpp"
+#include "hash.hpp"
+#include "packedpos.hpp"
+#include "rng.hpp"
+#include "timer.hpp"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+/* Texel tuner for the classical evaluation parameters, built as the AnkaTuner project (EVAL_TUNING defined).
+* Minimizes the mean squared error between the game results of a labeled position set and
+* Sigmoid(K * eval), eval being the white relative static evaluation.
+*
+* usage: AnkaTuner <positions.epd | positions.bin> [epochs] [threads] [output file]
+*        AnkaTuner convert <positions.epd> <positions.bin>
+* Each line of an EPD file is a position with its game result in a c9 opcode: <fen> c9 "1-0";
+* The convert command writes the positions in the packed format of packedpos.hpp, which loads much faster.
+*
+* Each position is evaluated once with TraceEvaluation while loading, and only the sparse coefficients of the
+* tuned terms, the phase and the endgame scale are kept (see EvalTrace). Evaluations and exact gradients are then
+* sparse dot products with the parameters, so the tuner never touches a board again. The endgame scale factors
+* and the known endgames are fixed at their values for the default parameters.
+*
+* K is fitted to the current parameters first. The parameters are then optimized with Adam over shuffled
+* mini batches, with the positions of each batch split across threads.
+*/
+namespace anka {
+	EvalParams g_eval_params;
+
+	namespace {
+		constexpr int DEFAULT_EPOCHS = 100;
+		constexpr const char* DEFAULT_OUTPUT = "tuned_params.txt";
+		constexpr size_t MINI_BATCH_SIZE = 16384;
+		constexpr double LEARNING_RATE = 1.0; // Adam step in centipawns
+		constexpr double BETA1 = 0.9;
+		constexpr double BETA2 = 0.999;
+		constexpr double EPSILON = 1e-8;
+		constexpr double LN10 = 2.302585092994046;
+		// The evaluation truncates twice (the scale factor division and the taper shift), less than 1 cp each,
+		// so a larger difference between the traced and the real evaluation means the trace missed a term
+		constexpr double MAX_TRACE_ERROR = 2.0;
+
+		using Params = std::array<int, EvalParams::NUM_PARAMS>;
+
+		// Parameter indices of the mg and eg values of each term
+		struct TermParams {
+			int mg[EvalTrace::NUM_TERMS]{};
+			int eg[EvalTrace::NUM_TERMS]{};
+
+			constexpr TermParams()
+			{
+				for (int term = 0; term < EvalTrace::NUM_TERMS; term++) {
+					mg[term] = EvalTrace::ParamIndex(term, MG);
+					eg[term] = EvalTrace::ParamIndex(term, EG);
+				}
+			}
+		};
+		constexpr TermParams term_params;
+
+		struct SparseTerm {
+			u16 index; // term index in EvalTrace
+			i16 coefficient;
+		};
+
+		struct TracedPosition {
+			u32 first_term; // in TrainingSet::terms
+			u16 num_terms;
+			i16 phase;
+			i16 scale;
+			i8 tempo;
+			bool fixed;
+			float fixed_eval;
+			float result; // 1 white wins, 0.5 draw, 0 black wins
+		};
+
+		struct TrainingSet {
+			std::vector<TracedPosition> positions; // shuffled each epoch
+			std::vector<SparseTerm> terms;
+
+			size_t Size() const { return positions.size(); }
+			void Shuffle(RNG& rng) { std::shuffle(positions.begin(), positions.end(), rng); }
+		};
+
+		class AdamOptimizer {
+		public:
+			explicit AdamOptimizer(size_t num_params) : m_moment1(num_params), m_moment2(num_params) {}
+
+			void Step(std::vector<double>& weights, const std::vector<double>& gradient)
+			{
+				m_step++;
+				double correction1 = 1.0 - pow(BETA1, m_step);
+				double correction2 = 1.0 - pow(BETA2, m_step);
+				for (size_t i = 0; i < weights.size(); i++) {
+					m_moment1[i] = BETA1 * m_moment1[i] + (1.0 - BETA1) * gradient[i];
+					m_moment2[i] = BETA2 * m_moment2[i] + (1.0 - BETA2) * gradient[i] * gradient[i];
+					weights[i] -= LEARNING_RATE * (m_moment1[i] / correction1) / (sqrt(m_moment2[i] / correction2) + EPSILON);
+				}
+			}
+		private:
+			std::vector<double> m_moment1;
+			std::vector<double> m_moment2;
+			int m_step = 0;
+		};
+
+		// Expected outcome (0-1) of a white relative evaluation in centipawns
+		double Sigmoid(double K, double eval)
+		{
+			return 1.0 / (1.0 + pow(10.0, (-K / 400.0) * eval));
+		}
+
+		// White relative evaluation of a traced position with the parameters 'weights'
+		double TracedEval(const TrainingSet& set, const TracedPosition& pos, const double* weights)
+		{
+			if (pos.fixed)
+				return pos.fixed_eval;
+
+			double mg = 0.0, eg = 0.0;
+			const SparseTerm* terms = &set.terms[pos.first_term];
+			for (int i = 0; i < pos.num_terms; i++) {
+				mg += terms[i].coefficient * weights[term_params.mg[terms[i].index]];
+				eg += terms[i].coefficient * weights[term_params.eg[terms[i].index]];
+			}
+
+			eg = eg * pos.scale / SCALE_NORMAL;
+			return (mg * (256 - pos.phase) + eg * pos.phase) / 256.0 + pos.tempo * weights[EvalTrace::TEMPO_PARAM_INDEX];
+		}
+
+		// Game result of a c9 opcode: 0 if black won, 1 for a draw, 2 if white won
+		bool ParseResult(const char* str, int& result)
+		{
+			if (strncmp(str, "1-0\"", 4) == 0)
+				result = 2;
+			else if (strncmp(str, "0-1\"", 4) == 0)
+				result = 0;
+			else if (strncmp(str, "1/2-1/2\"", 8) == 0)
+				result = 1;
+			else
+				return false;
+
+			return true;
+		}
+
+		// Calls func(pos, result) for each position of an EPD file with c9 results, stops if it returns false
+		template <typename F>
+		bool ForEachEpdPosition(const char* path, F&& func)
+		{
+			FILE* file = fopen(path, "r");
+			if (!file) {
+				fprintf(stderr, "AnkaError(Tuner): Failed to open %s\n", path);
+				return false;
+			}
+
+			constexpr int BUFFER_SIZE = 4096;
+			char line[BUFFER_SIZE];
+			int line_number = 0;
+			bool ok = true;
+			GameState pos;
+			while (ok && fgets(line, BUFFER_SIZE, file)) {
+				line_number++;
+				if (line[strspn(line, " \t\r\n")] == '\0')
+					continue;
+
+				char* result_str = strstr(line, "c9 \"");
+				int result;
+				if (!result_str || !ParseResult(result_str + 4, result)) {
+					fprintf(stderr, "AnkaError(Tuner): Missing or invalid result on line %d of %s\n", line_number, path);
+					ok = false;
+					break;
+				}
+
+				*result_str = '\0';
+				if (!pos.LoadPosition(line)) {
+					fprintf(stderr, "AnkaError(Tuner): Invalid position on line %d of %s\n", line_number, path);
+					ok = false;
+					break;
+				}
+
+				ok = func(pos, result);
+			}
+
+			fclose(file);
+			return ok;
+		}
+
+		// Loads and traces the positions of an EPD or packed position file.
+		// Compares the traced evaluations with the evaluations to check the trace.
+		bool LoadTrainingSet(const char* path, TrainingSet& set)
+		{
+			Params params;
+			g_eval_params.FlattenParams(params);
+			std::vector<double> weights(params.begin(), params.end());
+
+			EvalTrace trace;
+			double total_trace_error = 0.0, max_trace_error = 0.0;
+			size_t worst_position = 0;
+			auto add_position = [&](const GameState& pos, int result) {
+				int eval = TraceEvaluation(pos, trace);
+				TracedPosition traced{};
+				traced.first_term = static_cast<u32>(set.terms.size());
+				traced.phase = static_cast<i16>(trace.phase);
+				traced.scale = static_cast<i16>(trace.scale);
+				traced.tempo = static_cast<i8>(trace.tempo);
+				traced.fixed = trace.fixed;
+				traced.fixed_eval = static_cast<float>(trace.fixed_eval);
+				traced.result = result / 2.0f;
+				for (int term = 0; term < EvalTrace::NUM_TERMS; term++) {
+					if (trace.coefficients[term] != 0) {
+						set.terms.push_back({ static_cast<u16>(term), static_cast<i16>(trace.coefficients[term]) });
+						traced.num_terms++;
+					}
+				}
+				set.positions.push_back(traced);
+
+				double trace_error = fabs(TracedEval(set, traced, weights.data()) - trace.tempo * eval);
+				total_trace_error += trace_error;
+				if (trace_error > max_trace_error) {
+					max_trace_error = trace_error;
+					worst_position = set.positions.size() - 1;
+				}
+				return true;
+			};
+
+			bool ok;
+			if (PackedPositionFile::IsPackedFile(path)) {
+				PackedPositionFile file;
+				ok = file.Open(path);
+				if (ok) {
+					set.positions.reserve(file.Size());
+				}
+
+				GameState pos;
+				for (size_t i = 0; ok && i < file.Size(); i++) {
+					const PackedPosition& packed = file.Positions()[i];
+					ok = pos.LoadPacked(packed);
+					if (!ok)
+						fprintf(stderr, "AnkaError(Tuner): Invalid position %zu in %s\n", i, path);
+					else
+						add_position(pos, packed.Result());
+				}
+			}
+			else {
+				ok = ForEachEpdPosition(path, add_position);
+			}
+
+			if (ok && set.positions.empty()) {
+				fprintf(stderr, "AnkaError(Tuner): %s has no positions\n", path);
+				ok = false;
+			}
+
+			if (ok) {
+				printf("%zu positions, %.1f terms per position, trace error %.2f cp on average, %.2f cp at most\n",
+					set.Size(), set.terms.size() / static_cast<double>(set.Size()), total_trace_error / set.Size(), max_trace_error);
+			}
+
+			// tuning coefficients that don't reproduce the evaluation would optimize a different function
+			if (ok && max_trace_error >= MAX_TRACE_ERROR) {
+				fprintf(stderr, "AnkaError(Tuner): The trace differs from the evaluation by %.2f cp in position %zu of %s, "
+					"an evaluation term isn't traced\n", max_trace_error, worst_position, path);
+				ok = false;
+			}
+			return ok;
+		}
+
+		// Converts an EPD file with c9 results to a packed position file
+		bool ConvertToPacked(const char* epd_path, const char* packed_path)
+		{
+			PackedPositionWriter writer;
+			if (!writer.Open(packed_path))
+				return false;
+
+			PackedPosition packed;
+			bool ok = ForEachEpdPosition(epd_path, [&](const GameState& pos, int result) {
+				PackPosition(pos, result, PackedPosition::NO_SCORE, packed);
+				return writer.Write(packed);
+			});
+
+			ok = writer.Close() && ok;
+			if (ok)
+				printf("%" PRIu64 " positions written to %s\n", writer.Size(), packed_path);
+			return ok;
+		}
+
+		// Sum of the squared errors of positions [begin, end), on the calling thread.
+		// Adds the gradient of the sum to 'gradient' unless it is null.
+		double SquaredError(const TrainingSet& set, size_t begin, size_t end, double K, const double* weights, double* gradient)
+		{
+			double error = 0.0;
+			for (size_t i = begin; i < end; i++) {
+				const TracedPosition& pos = set.positions[i];
+				double sigmoid = Sigmoid(K, TracedEval(set, pos, weights));
+				double diff = pos.result - sigmoid;
+				error += diff * diff;
+				if (!gradient || pos.fixed)
+					continue;
+
+				// derivative of the squared error with respect to the evaluation
+				double d_eval = -2.0 * diff * sigmoid * (1.0 - sigmoid) * K * LN10 / 400.0;
+				double d_mg = d_eval * (256 - pos.phase) / 256.0;
+				double d_eg = d_eval * pos.phase * pos.scale / (256.0 * SCALE_NORMAL);
+				const SparseTerm* terms = &set.terms[pos.first_term];
+				for (int j = 0; j < pos.num_terms; j++) {
+					gradient[term_params.mg[terms[j].index]] += d_mg * terms[j].coefficient;
+					gradient[term_params.eg[terms[j].index]] += d_eg * terms[j].coefficient;
+				}
+				gradient[EvalTrace::TEMPO_PARAM_INDEX] += d_eval * pos.tempo;
+			}
+
+			return error;
+		}
+
+		// Mean squared error of positions [begin, end). Stores the gradient of the mean in 'gradient' unless it is null
+		double MeanSquaredError(const TrainingSet& set, size_t begin, size_t end, double K, const std::vector<double>& weights,
+			int num_threads, std::vector<double>* gradient)
+		{
+			size_t count = end - begin;
+			size_t chunk_size = (count + num_threads - 1) / num_threads;
+			std::vector<double> errors(num_threads, 0.0);
+			std::vector<std::vector<double>> gradients(gradient ? num_threads : 0, std::vector<double>(EvalParams::NUM_PARAMS, 0.0));
+			auto work = [&](int t) {
+				size_t chunk_begin = Min(begin + t * chunk_size, end);
+				size_t chunk_end = Min(chunk_begin + chunk_size, end);
+				errors[t] = SquaredError(set, chunk_begin, chunk_end, K, weights.data(), gradient ? gradients[t].data() : nullptr);
+			};
+
+			std::vector<std::thread> threads;
+			for (int t = 1; t < num_threads; t++)
+				threads.emplace_back(work, t);
+			work(0);
+			for (std::thread& thread : threads)
+				thread.join();
+
+			if (gradient) {
+				for (int i = 0; i < EvalParams::NUM_PARAMS; i++) {
+					double sum = 0.0;
+					for (int t = 0; t < num_threads; t++)
+						sum += gradients[t][i];
+					(*gradient)[i] = sum / count;
+				}
+			}
+
+			return std::accumulate(errors.begin(), errors.end(), 0.0) / count;
+		}
+
+		// Ternary search for the K that minimizes the error of 'weights'
+		double FindK(const TrainingSet& set, const std::vector<double>& weights, int num_threads)
+		{
+			double low = 0.0, high = 4.0;
+			for (int i = 0; i < 40; i++) {
+				double k1 = low + (high - low) / 3.0;
+				double k2 = high - (high - low) / 3.0;
+				if (MeanSquaredError(set, 0, set.Size(), k1, weights, num_threads, nullptr)
+					< MeanSquaredError(set, 0, set.Size(), k2, weights, num_threads, nullptr))
+					high = k2;
+				else
+					low = k1;
+			}
+
+			return (low + high) / 2.0;
+		}
+
+		void Tune(RNG& rng, TrainingSet& set, int num_epochs, int num_threads, const char* output_path)
+		{
+			Params params;
+			g_eval_params.FlattenParams(params);
+			std::vector<double> weights(params.begin(), params.end());
+			std::vector<double> rounded_weights(EvalParams::NUM_PARAMS);
+
+			printf("Fitting K...\n");
+			const double K = FindK(set, weights, num_threads);
+			double best_error = MeanSquaredError(set, 0, set.Size(), K, weights, num_threads, nullptr);
+			printf("K: %f MSE: %f\n", K, best_error);
+
+			AdamOptimizer optimizer(EvalParams::NUM_PARAMS);
+			std::vector<double> gradient(EvalParams::NUM_PARAMS);
+			for (int epoch = 1; epoch <= num_epochs; epoch++) {
+				long long start_time = Timer::GetTimeInMs();
+				set.Shuffle(rng);
+
+				for (size_t begin = 0; begin < set.Size(); begin += MINI_BATCH_SIZE) {
+					size_t end = Min(begin + MINI_BATCH_SIZE, set.Size());
+					MeanSquaredError(set, begin, end, K, weights, num_threads, &gradient);
+					optimizer.Step(weights, gradient);
+				}
+
+				// the engine uses integer parameters
+				for (int i = 0; i < EvalParams::NUM_PARAMS; i++) {
+					params[i] = static_cast<int>(lround(weights[i]));
+					rounded_weights[i] = params[i];
+				}
+				double error = MeanSquaredError(set, 0, set.Size(), K, rounded_weights, num_threads, nullptr);
+				printf("Epoch %d MSE: %f RMSE: %f Time: %lld ms\n", epoch, error, sqrt(error), Timer::GetTimeInMs() - start_time);
+
+				if (error < best_error) {
+					best_error = error;
+					g_eval_params.UpdateParams(params);
+					g_eval_params.WriteParamsToFile(output_path);
+				}
+			}
+
+			printf("Done. Best MSE: %f, parameters written to %s\n", best_error, output_path);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace anka;
+
+	setbuf(stdout, NULL); // unbuffered output
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <positions.epd | positions.bin> [epochs] [threads] [output file]\n", argv[0]);
+		fprintf(stderr, "       %s convert <positions.epd> <positions.bin>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char* input_path = argv[1];
+	int num_epochs = argc > 2 ? atoi(argv[2]) : DEFAULT_EPOCHS;
+	int num_threads = argc > 3 ? atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+	const char* output_path = argc > 4 ? argv[4] : DEFAULT_OUTPUT;
+	if (num_epochs <= 0)
+		num_epochs = DEFAULT_EPOCHS;
+	if (num_threads <= 0)
+		num_threads = 1;
+
+	constexpr u64 RNG_SEED = 6700417;
+	RNG rng(RNG_SEED);
+	InitZobristKeys(rng);
+	attacks::InitAttacks();
+	InitEndgames();
+
+	if (strcmp(argv[1], "convert") == 0) {
+		if (argc < 4) {
+			fprintf(stderr, "usage: %s convert <positions.epd> <positions.bin>\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		return ConvertToPacked(argv[2], argv[3]) ? 0 : EXIT_FAILURE;
+	}
+
+	printf("Reading and tracing %s...\n", input_path);
+	TrainingSet set;
+	if (!LoadTrainingSet(input_path, set))
+		return EXIT_FAILURE;
+
+	printf("%d parameters, %d threads\n", EvalParams::NUM_PARAMS, num_threads);
+	Tune(rng, set, num_epochs, num_threads, output_path);
+	return 0;
+}
@@ -3,348 +3,450 @@
 #include <math.h>
 #include <array>
 
-#ifdef EVAL_TUNING
-#define eval_param int
-#else
-#define eval_param static constexpr int
-#endif
-
 namespace anka {
-
-	struct EvalScore {
-		int phase_score[NUM_PHASES]{};
+	// Phase calculation piece weights for tapered eval.
+	// Implementation is based on chessprogramming.org/Tapered_Eval
+	inline constexpr int p_phase[8] = { 0, 0, 0, 1, 1, 2, 4, 0 };
+	inline constexpr int MAX_PHASE = p_phase[PAWN] * 16 + p_phase[KNIGHT] * 4
+		+ p_phase[BISHOP] * 4 + p_phase[ROOK] * 4
+		+ p_phase[QUEEN] * 2;
+
+	/* Attack maps of a position, built once per evaluation and shared by the evaluation terms.
+	* attacks[side][piece_type] has the squares attacked by that piece type, attacks[side][ALL_PIECES]
+	* the squares attacked by any piece, double_attacks[side] the squares attacked at least twice.
+	* mobility[side][piece_type] is the number of attacked squares not occupied by own pieces,
+	* summed over the pieces of the type.
+	*/
+	struct AttackInfo {
+		Bitboard attacks[NUM_SIDES][ALL_PIECES + 1];
+		Bitboard double_attacks[NUM_SIDES];
+		int mobility[NUM_SIDES][ALL_PIECES];
+
+		void Build(const GameState& pos);
 	};
 
 
-	struct EvalParams {
-		static constexpr int NUM_PARAMS = 787;
-		
-
-		int PST_mg[2][8][64]{ 0 };
-		int PST_eg[2][8][64]{ 0 };
-
-		eval_param piece_values[NUM_PHASES][8] = {
+	// ***Generated by the evaluation tuner***
+	namespace eval_defaults {
+		inline constexpr int piece_values[NUM_PHASES][8] = {
 			{0, 0, 85, 346, 342, 463, 927, 0},
 			{0, 0, 95, 302, 305, 516, 927, 0}
 		};
 
-		eval_param mobility_weights[NUM_PHASES][8] = {
+		inline constexpr int mobility_weights[NUM_PHASES][8] = {
 			{0, 0, 2, 4, 5, 6, 1, 0},
 			{0, 0, 2, 0, 2, 3, 9, 0}
 		};
 
-		eval_param passed_bonus[NUM_PHASES][8] = {
+		inline constexpr int passed_bonus[NUM_PHASES][8] = {
 			{0, 3, 1, 3, 13, 46, 69, 0},
 			{0, 2, 3, 21, 40, 59, 73, 0}
 		};
 
-		eval_param isolated_penalty[NUM_PHASES][8] = {
+		inline constexpr int isolated_penalty[NUM_PHASES][8] = {
 			{20, 15, 15, 24, 30, 17, 14, 27},
 			{-4, 7, 10, 21, 18, 7, 5, 1}
 		};
 
-		eval_param bishop_pair_bonus[NUM_PHASES] = { 34, 43 };
-		eval_param tempo_bonus = 18;
-
-		eval_param pawns_pst_mg[64]{
-			0, 0, 0, 0, 0, 0, 0, 0,
-			68, 81, 68, 77, 72, 70, 54, 63,
-			29, 37, 24, 11, 39, 47, 27, 15,
-			-5, 11, 3, 25, 19, 16, 5, -18,
-			-17, -11, 9, 18, 22, 6, -12, -17,
-			-7, -13, 6, -1, 10, 3, 10, 0,
-			-13, -7, -12, -9, -2, 23, 16, -4,
-			0, 0, 0, 0, 0, 0, 0, 0
+		inline constexpr int bishop_pair_bonus[NUM_PHASES][1] = {
+			{34},
+			{43}
 		};
 
-		eval_param pawns_pst_eg[64]{
-			0, 0, 0, 0, 0, 0, 0, 0,
-			81, 72, 74, 82, 77, 72, 75, 72,
-			36, 28, 45, 32, 22, 25, 31, 39,
-			14, 13, 3, 1, 10, -9, 8, 12,
-			4, 10, -12, -3, -10, -13, 0, -4,
-			-9, 7, -12, 4, 0, -8, -5, -12,
-			-1, 3, 4, 5, -1, -4, -4, -15,
-			0, 0, 0, 0, 0, 0, 0, 0
-		};
-
-		eval_param knights_pst_mg[64]{
-			-74, -58, -46, -44, -12, -58, -69, -71,
-			-62, -47, 23, 14, -1, 28, -3, -34,
-			-43, 21, 15, 39, 43, 26, 23, 4,
-			-22, 4, -4, 33, 13, 37, 8, -6,
-			-21, 0, 9, 0, 16, 6, 13, -14,
-			-30, -16, 0, 6, 18, 11, 15, -20,
-			-29, -47, -13, 1, 5, 12, -23, -17,
-			-82, -17, -43, -27, -10, -18, -15, -46
-		};
-
-		eval_param knights_pst_eg[64]{
-			-75, -49, -17, -34, -23, -49, -60, -75,
-			-30, -8, -17, -2, -13, -27, -31, -54,
-			-30, -13, 13, 6, -1, 10, -10, -39,
-			-14, 5, 27, 23, 25, 16, 5, -11,
-			-17, -9, 14, 26, 16, 19, 5, -21,
-			-23, -3, -4, 12, 7, -8, -17, -24,
-			-40, -22, -9, -10, -8, -18, -19, -51,
-			-38, -43, -23, -14, -25, -23, -50, -66
-		};
-
-		eval_param bishops_pst_mg[64]{
-			-45, -24, -43, -43, -24, -30, -28, -16,
-			-30, -11, -36, -23, 8, 23, 7, -28,
-			-32, 10, 24, 10, 13, 33, 17, -20,
-			-20, -16, -4, 27, 20, 10, -9, -12,
-			-16, -3, -8, 17, 11, -15, -7, 1,
-			-10, 6, 9, -7, -2, 16, 5, -5,
-			4, 13, 5, -5, 0, 12, 22, -3,
-			-32, 4, -9, -13, -13, -13, -36, -33
-		};
-
-		eval_param bishops_pst_eg[64]{
-			-19, -17, -20, -11, -9, -16, -17, -26,
-			-11, -5, 3, -16, -11, -8, -10, -30,
-			-3, -8, -9, -3, -12, -7, -2, 1,
-			-2, 7, 8, 0, 0, 3, -3, -3,
-			-7, -3, 9, 5, -1, 5, -5, -9,
-			-8, -4, 1, 6, 12, -7, -5, -11,
-			-18, -21, -12, -6, 1, -10, -11, -28,
-			-24, -13, -17, -3, -6, -11, -6, -12
+		inline constexpr int pawns_pst[NUM_PHASES][64] = {
+			{
+				0, 0, 0, 0, 0, 0, 0, 0,
+				68, 81, 68, 77, 72, 70, 54, 63,
+				29, 37, 24, 11, 39, 47, 27, 15,
+				-5, 11, 3, 25, 19, 16, 5, -18,
+				-17, -11, 9, 18, 22, 6, -12, -17,
+				-7, -13, 6, -1, 10, 3, 10, 0,
+				-13, -7, -12, -9, -2, 23, 16, -4,
+				0, 0, 0, 0, 0, 0, 0, 0
+			},
+			{
+				0, 0, 0, 0, 0, 0, 0, 0,
+				81, 72, 74, 82, 77, 72, 75, 72,
+				36, 28, 45, 32, 22, 25, 31, 39,
+				14, 13, 3, 1, 10, -9, 8, 12,
+				4, 10, -12, -3, -10, -13, 0, -4,
+				-9, 7, -12, 4, 0, -8, -5, -12,
+				-1, 3, 4, 5, -1, -4, -4, -15,
+				0, 0, 0, 0, 0, 0, 0, 0
+			}
 		};
 
-		eval_param rooks_pst_mg[64]{
-			2, 8, -8, 14, 20, -3, 1, 6,
-			5, 10, 38, 36, 36, 46, 15, 16,
-			-10, 6, 2, 2, -1, 15, 35, 3,
-			-20, -30, -5, 11, 3, 16, -18, -26,
-			-31, -21, -12, -13, 0, -18, -3, -30,
-			-27, -20, -12, -15, 0, -5, -14, -26,
-			-32, -9, -9, 0, 12, 10, -10, -15,
-			-9, -4, 14, 21, 24, 16, -23, -8
+		inline constexpr int knights_pst[NUM_PHASES][64] = {
+			{
+				-74, -58, -46, -44, -12, -58, -69, -71,
+				-62, -47, 23, 14, -1, 28, -3, -34,
+				-43, 21, 15, 39, 43, 26, 23, 4,
+				-22, 4, -4, 33, 13, 37, 8, -6,
+				-21, 0, 9, 0, 16, 6, 13, -14,
+				-30, -16, 0, 6, 18, 11, 15, -20,
+				-29, -47, -13, 1, 5, 12, -23, -17,
+				-82, -17, -43, -27, -10, -18, -15, -46
+			},
+			{
+				-75, -49, -17, -34, -23, -49, -60, -75,
+				-30, -8, -17, -2, -13, -27, -31, -54,
+				-30, -13, 13, 6, -1, 10, -10, -39,
+				-14, 5, 27, 23, 25, 16, 5, -11,
+				-17, -9, 14, 26, 16, 19, 5, -21,
+				-23, -3, -4, 12, 7, -8, -17, -24,
+				-40, -22, -9, -10, -8, -18, -19, -51,
+				-38, -43, -23, -14, -25, -23, -50, -66
+			}
 		};
 
-		eval_param rooks_pst_eg[64]{
-			19, 13, 19, 13, 13, 16, 13, 12,
-			21, 20, 13, 17, 6, 5, 13, 12,
-			12, 11, 12, 11, 5, 1, -1, 0,
-			13, 15, 16, 2, 7, 7, 6, 13,
-			12, 13, 13, 9, 0, 5, 1, 5,
-			5, 9, 1, 6, -3, -1, 3, -6,
-			2, -2, 4, 8, -3, -3, -3, -12,
-			-2, 4, -1, -2, -6, -7, 0, -17
+		inline constexpr int bishops_pst[NUM_PHASES][64] = {
+			{
+				-45, -24, -43, -43, -24, -30, -28, -16,
+				-30, -11, -36, -23, 8, 23, 7, -28,
+				-32, 10, 24, 10, 13, 33, 17, -20,
+				-20, -16, -4, 27, 20, 10, -9, -12,
+				-16, -3, -8, 17, 11, -15, -7, 1,
+				-10, 6, 9, -7, -2, 16, 5, -5,
+				4, 13, 5, -5, 0, 12, 22, -3,
+				-32, 4, -9, -13, -13, -13, -36, -33
+			},
+			{
+				-19, -17, -20, -11, -9, -16, -17, -26,
+				-11, -5, 3, -16, -11, -8, -10, -30,
+				-3, -8, -9, -3, -12, -7, -2, 1,
+				-2, 7, 8, 0, 0, 3, -3, -3,
+				-7, -3, 9, 5, -1, 5, -5, -9,
+				-8, -4, 1, 6, 12, -7, -5, -11,
+				-18, -21, -12, -6, 1, -10, -11, -28,
+				-24, -13, -17, -3, -6, -11, -6, -12
+			}
 		};
 
-		eval_param queens_pst_mg[64]{
-			-28, -2, 2, -1, 15, 17, 6, 2,
-			-34, -26, -11, -6, -2, 34, 23, 11,
-			-23, -11, -14, -6, 17, 46, 18, 23,
-			-27, -29, -20, -24, -1, 2, 1, -6,
-			-15, -17, -11, -21, -11, -12, -5, -4,
-			-25, -2, -7, -5, -7, -5, 7, 2,
-			-27, -9, 7, 4, 15, 15, -7, 10,
-			-3, -9, -1, 15, -2, -16, -17, -38
+		inline constexpr int rooks_pst[NUM_PHASES][64] = {
+			{
+				2, 8, -8, 14, 20, -3, 1, 6,
+				5, 10, 38, 36, 36, 46, 15, 16,
+				-10, 6, 2, 2, -1, 15, 35, 3,
+				-20, -30, -5, 11, 3, 16, -18, -26,
+				-31, -21, -12, -13, 0, -18, -3, -30,
+				-27, -20, -12, -15, 0, -5, -14, -26,
+				-32, -9, -9, 0, 12, 10, -10, -15,
+				-9, -4, 14, 21, 24, 16, -23, -8
+			},
+			{
+				19, 13, 19, 13, 13, 16, 13, 12,
+				21, 20, 13, 17, 6, 5, 13, 12,
+				12, 11, 12, 11, 5, 1, -1, 0,
+				13, 15, 16, 2, 7, 7, 6, 13,
+				12, 13, 13, 9, 0, 5, 1, 5,
+				5, 9, 1, 6, -3, -1, 3, -6,
+				2, -2, 4, 8, -3, -3, -3, -12,
+				-2, 4, -1, -2, -6, -7, 0, -17
+			}
 		};
 
-		eval_param queens_pst_eg[64]{
-			-12, 11, 11, 10, 33, 16, 13, 5,
-			-8, -13, 6, 18, 19, 21, 20, 10,
-			-12, -16, -12, 14, 24, 21, 26, 17,
-			-5, -6, -13, 6, 15, 19, 33, 16,
-			-14, -4, -9, 24, 2, 20, 22, 26,
-			7, -22, -6, -13, -1, 17, 11, 16,
-			-10, -16, -17, -8, -17, -13, -20, -15,
-			-11, -21, -11, -18, -3, -12, -14, -37
+		inline constexpr int queens_pst[NUM_PHASES][64] = {
+			{
+				-28, -2, 2, -1, 15, 17, 6, 2,
+				-34, -26, -11, -6, -2, 34, 23, 11,
+				-23, -11, -14, -6, 17, 46, 18, 23,
+				-27, -29, -20, -24, -1, 2, 1, -6,
+				-15, -17, -11, -21, -11, -12, -5, -4,
+				-25, -2, -7, -5, -7, -5, 7, 2,
+				-27, -9, 7, 4, 15, 15, -7, 10,
+				-3, -9, -1, 15, -2, -16, -17, -38
+			},
+			{
+				-12, 11, 11, 10, 33, 16, 13, 5,
+				-8, -13, 6, 18, 19, 21, 20, 10,
+				-12, -16, -12, 14, 24, 21, 26, 17,
+				-5, -6, -13, 6, 15, 19, 33, 16,
+				-14, -4, -9, 24, 2, 20, 22, 26,
+				7, -22, -6, -13, -1, 17, 11, 16,
+				-10, -16, -17, -8, -17, -13, -20, -15,
+				-11, -21, -11, -18, -3, -12, -14, -37
+			}
 		};
 
-		eval_param king_pst_mg[64]{
-			-35, -13, -18, -32, -59, -13, -13, -3,
-			-5, -22, -14, -24, -35, -13, -21, -19,
-			6, -17, -11, -35, -49, -3, -16, -7,
-			-4, -22, -20, -54, -62, -36, -15, -17,
-			-37, -19, -36, -61, -59, -39, -27, -49,
-			-4, -10, -33, -36, -45, -42, -9, -19,
-			20, 21, -11, -22, -33, -22, 24, 30,
-			5, 52, 24, -10, 12, -16, 47, 27
+		inline constexpr int king_pst[NUM_PHASES][64] = {
+			{
+				-35, -13, -18, -32, -59, -13, -13, -3,
+				-5, -22, -14, -24, -35, -13, -21, -19,
+				6, -17, -11, -35, -49, -3, -16, -7,
+				-4, -22, -20, -54, -62, -36, -15, -17,
+				-37, -19, -36, -61, -59, -39, -27, -49,
+				-4, -10, -33, -36, -45, -42, -9, -19,
+				20, 21, -11, -22, -33, -22, 24, 30,
+				5, 52, 24, -10, 12, -16, 47, 27
+			},
+			{
+				-74, -31, -22, -25, -16, -1, -13, -32,
+				-14, 9, 6, 10, 11, 16, 6, -6,
+				-1, 14, 19, 12, 14, 37, 14, -13,
+				-20, 17, 19, 27, 28, 28, 16, -11,
+				-27, -7, 15, 24, 24, 18, 1, -18,
+				-29, -10, 6, 14, 19, 12, 0, -19,
+				-44, -25, -3, 0, 6, 1, -18, -38,
+				-76, -53, -32, -32, -36, -22, -44, -64
+			}
 		};
 
-		eval_param king_pst_eg[64]{
-			-74, -31, -22, -25, -16, -1, -13, -32,
-			-14, 9, 6, 10, 11, 16, 6, -6,
-			-1, 14, 19, 12, 14, 37, 14, -13,
-			-20, 17, 19, 27, 28, 28, 16, -11,
-			-27, -7, 15, 24, 24, 18, 1, -18,
-			-29, -10, 6, 14, 19, 12, 0, -19,
-			-44, -25, -3, 0, 6, 1, -18, -38,
-			-76, -53, -32, -32, -36, -22, -44, -64
-		};
+		inline constexpr int tempo_bonus = 18;
+	}
+
+	/* Descriptor of the tuned evaluation parameters. Each table is int name[NUM_PHASES][size] with its default
+	* values in eval_defaults. Only the entries in [first, last) are tuned, the others are always 0.
+	* X(name, size, first, last)
+	*/
+	#define ANKA_EVAL_TABLES(X) \
+		X(piece_values, 8, PAWN, KING) \
+		X(mobility_weights, 8, PAWN, KING) \
+		X(passed_bonus, 8, RANK_TWO, RANK_EIGHT) \
+		X(isolated_penalty, 8, FILE_A, FILE_H + 1) \
+		X(bishop_pair_bonus, 1, 0, 1) \
+		X(pawns_pst, 64, A2, A8) \
+		X(knights_pst, 64, A1, H8 + 1) \
+		X(bishops_pst, 64, A1, H8 + 1) \
+		X(rooks_pst, 64, A1, H8 + 1) \
+		X(queens_pst, 64, A1, H8 + 1) \
+		X(king_pst, 64, A1, H8 + 1)
+
+	// Tuned parameters that don't depend on the game phase. X(name)
+	#define ANKA_EVAL_SCALARS(X) \
+		X(tempo_bonus)
+
+	/* The evaluation parameters and the packed tables built from them. g_eval_params is constexpr in engine builds,
+	* so the tables are built by the compiler and every parameter is a compile time constant.
+	* The tuner changes the parameters with UpdateParams, which rebuilds the tables.
+	*/
+	struct EvalParams {
+		#define ANKA_COUNT_TABLE(name, size, first, last) + NUM_PHASES * ((last) - (first))
+		#define ANKA_COUNT_SCALAR(name) + 1
+		static constexpr int NUM_PARAMS = 0 ANKA_EVAL_TABLES(ANKA_COUNT_TABLE) ANKA_EVAL_SCALARS(ANKA_COUNT_SCALAR);
+		#undef ANKA_COUNT_TABLE
+		#undef ANKA_COUNT_SCALAR
+
+		#define ANKA_DECLARE_TABLE(name, size, first, last) int name[NUM_PHASES][size]{};
+		#define ANKA_DECLARE_SCALAR(name) int name = 0;
+		ANKA_EVAL_TABLES(ANKA_DECLARE_TABLE)
+		ANKA_EVAL_SCALARS(ANKA_DECLARE_SCALAR)
+		#undef ANKA_DECLARE_TABLE
+		#undef ANKA_DECLARE_SCALAR
+
+		// Packed tables built from the parameters by InitTables.
+		// PST has the piece value + piece-square score from white's point of view, negated for black pieces
+		Score PST[NUM_SIDES][8][64]{};
+		Score mobility[8]{};
+		Score passed[8]{}; // by relative rank
+		Score isolated[8]{}; // by file
+		Score bishop_pair{};
+
+		constexpr EvalParams()
+		{
+			#define ANKA_COPY_TABLE(name, size, first, last) \
+				for (int phase = 0; phase < NUM_PHASES; phase++) \
+					for (int i = 0; i < size; i++) \
+						name[phase][i] = eval_defaults::name[phase][i];
+			#define ANKA_COPY_SCALAR(name) name = eval_defaults::name;
+			ANKA_EVAL_TABLES(ANKA_COPY_TABLE)
+			ANKA_EVAL_SCALARS(ANKA_COPY_SCALAR)
+			#undef ANKA_COPY_TABLE
+			#undef ANKA_COPY_SCALAR
+
+			InitTables();
+		}
 
-		void InitPST()
+		constexpr void InitTables()
 		{
-			for (Side color = WHITE; color < NUM_SIDES; color++) {
-				for (Square sq = A1; sq <= H8; sq++) {
-					Square pst_sq = (color == WHITE ? sq ^ 56 : sq);
-
-					PST_mg[color][PAWN][sq] = pawns_pst_mg[pst_sq] + piece_values[MG][PAWN];
-					PST_mg[color][KNIGHT][sq] = knights_pst_mg[pst_sq] + piece_values[MG][KNIGHT];
-					PST_mg[color][BISHOP][sq] = bishops_pst_mg[pst_sq] + piece_values[MG][BISHOP];
-					PST_mg[color][ROOK][sq] = rooks_pst_mg[pst_sq] + piece_values[MG][ROOK];
-					PST_mg[color][QUEEN][sq] = queens_pst_mg[pst_sq] + piece_values[MG][QUEEN];
-					PST_mg[color][KING][sq] = king_pst_mg[pst_sq] + piece_values[MG][KING];
-
-					PST_eg[color][PAWN][sq] = pawns_pst_eg[pst_sq] + piece_values[EG][PAWN];
-					PST_eg[color][KNIGHT][sq] = knights_pst_eg[pst_sq] + piece_values[EG][KNIGHT];
-					PST_eg[color][BISHOP][sq] = bishops_pst_eg[pst_sq] + piece_values[EG][BISHOP];
-					PST_eg[color][ROOK][sq] = rooks_pst_eg[pst_sq] + piece_values[EG][ROOK];
-					PST_eg[color][QUEEN][sq] = queens_pst_eg[pst_sq] + piece_values[EG][QUEEN];
-					PST_eg[color][KING][sq] = king_pst_eg[pst_sq] + piece_values[EG][KING];
-				}
+			InitPST(PAWN, pawns_pst);
+			InitPST(KNIGHT, knights_pst);
+			InitPST(BISHOP, bishops_pst);
+			InitPST(ROOK, rooks_pst);
+			InitPST(QUEEN, queens_pst);
+			InitPST(KING, king_pst);
+
+			for (int i = 0; i < 8; i++) {
+				mobility[i] = Score(mobility_weights[MG][i], mobility_weights[EG][i]);
+				passed[i] = Score(passed_bonus[MG][i], passed_bonus[EG][i]);
+				isolated[i] = Score(isolated_penalty[MG][i], isolated_penalty[EG][i]);
 			}
+			bishop_pair = Score(bishop_pair_bonus[MG][0], bishop_pair_bonus[EG][0]);
 		}
 
 #ifdef EVAL_TUNING
 		void UpdateParams(const std::array<int, NUM_PARAMS>& new_params)
 		{
-			for (Square sq = 0; sq <= H8; sq++) {
-				knights_pst_mg[sq] = new_params[sq];
-				knights_pst_eg[sq] = new_params[64 + sq];
-				bishops_pst_mg[sq] = new_params[128 + sq];
-				bishops_pst_eg[sq] = new_params[192 + sq];
-				rooks_pst_mg[sq] = new_params[256 + sq];
-				rooks_pst_eg[sq] = new_params[320 + sq];
-				queens_pst_mg[sq] = new_params[384 + sq];
-				queens_pst_eg[sq] = new_params[448 + sq];
-				king_pst_mg[sq] = new_params[512 + sq];
-				king_pst_eg[sq] = new_params[576 + sq];
-			}
-
-			for (int i = 0; i < 48; i++) {
-				pawns_pst_mg[8 + i] = new_params[640 + i];
-				pawns_pst_eg[8 + i] = new_params[688 + i];
-			}
-
-			for (int i = 0; i < 2; i++) {
-				for (int j = 0; j < 5; j++) {
-					piece_values[i][2+j] = new_params[736 + 5*i + j];
-					mobility_weights[i][2+j] = new_params[746 + 5*i + j];
-				}
-
-				for (int j = 0; j < 6; j++) {
-					passed_bonus[i][1+j] = new_params[756 + i * 6 + j];
-				}
-
-				for (int j = 0; j < 8; j++) {	
-					isolated_penalty[i][j] = new_params[768 + i * 8 + j];
-				}
-			}
-
-			bishop_pair_bonus[0] = new_params[784];
-			bishop_pair_bonus[1] = new_params[785];
-			tempo_bonus = new_params[786];
-
-			InitPST();
+			int index = 0;
+			#define ANKA_UPDATE_TABLE(name, size, first, last) \
+				for (int phase = 0; phase < NUM_PHASES; phase++) \
+					for (int i = (first); i < (last); i++) \
+						name[phase][i] = new_params[index++];
+			#define ANKA_UPDATE_SCALAR(name) name = new_params[index++];
+			ANKA_EVAL_TABLES(ANKA_UPDATE_TABLE)
+			ANKA_EVAL_SCALARS(ANKA_UPDATE_SCALAR)
+			#undef ANKA_UPDATE_TABLE
+			#undef ANKA_UPDATE_SCALAR
+
+			InitTables();
 		}
 
 		void FlattenParams(std::array<int, NUM_PARAMS>& out_params) const
 		{
-			for (Square sq = 0; sq <= H8; sq++) {
-				out_params[sq] = knights_pst_mg[sq];
-				out_params[64 + sq] = knights_pst_eg[sq];
-				out_params[128 + sq] = bishops_pst_mg[sq];
-				out_params[192 + sq] = bishops_pst_eg[sq];
-				out_params[256 + sq] = rooks_pst_mg[sq];
-				out_params[320 + sq] = rooks_pst_eg[sq];
-				out_params[384 + sq] = queens_pst_mg[sq];
-				out_params[448 + sq] = queens_pst_eg[sq];
-				out_params[512 + sq] = king_pst_mg[sq];
-				out_params[576 + sq] = king_pst_eg[sq];
-			}
+			int index = 0;
+			#define ANKA_FLATTEN_TABLE(name, size, first, last) \
+				for (int phase = 0; phase < NUM_PHASES; phase++) \
+					for (int i = (first); i < (last); i++) \
+						out_params[index++] = name[phase][i];
+			#define ANKA_FLATTEN_SCALAR(name) out_params[index++] = name;
+			ANKA_EVAL_TABLES(ANKA_FLATTEN_TABLE)
+			ANKA_EVAL_SCALARS(ANKA_FLATTEN_SCALAR)
+			#undef ANKA_FLATTEN_TABLE
+			#undef ANKA_FLATTEN_SCALAR
+		}
+#endif
 
-			for (int i = 0; i < 48; i++) {
-				out_params[640 + i] = pawns_pst_mg[8 + i];
-				out_params[688 + i] = pawns_pst_eg[8 + i];
+		// Writes the parameters in the format of eval_defaults
+		void WriteParamsToFile(const char *file_name) const
+		{
+			FILE* file_stream = fopen(file_name, "w");
+			if (file_stream == NULL) {
+				fprintf(stderr, "Failed to open %s\n", file_name);
+				return;
 			}
 
-			for (int i = 0; i < 2; i++) {
-				for (int j = 0; j < 5; j++) {
-					out_params[736 + 5 * i + j] = piece_values[i][2 + j];
-					out_params[746 + 5 * i + j] = mobility_weights[i][2 + j];
-				}
+			fprintf(file_stream, "// ***Generated by the evaluation tuner***\n");
+			#define ANKA_WRITE_TABLE(name, size, first, last) \
+				WriteTable(file_stream, STRINGIFY(name), &name[0][0], size);
+			#define ANKA_WRITE_SCALAR(name) \
+				fprintf(file_stream, "inline constexpr int " STRINGIFY(name) " = %d;\n\n", name);
+			ANKA_EVAL_TABLES(ANKA_WRITE_TABLE)
+			ANKA_EVAL_SCALARS(ANKA_WRITE_SCALAR)
+			#undef ANKA_WRITE_TABLE
+			#undef ANKA_WRITE_SCALAR
 
-				for (int j = 0; j < 6; j++) {
-					out_params[756 + i * 6 + j] = passed_bonus[i][1 + j];
-				}
+			fclose(file_stream);
+		}
+	private:
+		constexpr void InitPST(PieceType piece, const int (&pst)[NUM_PHASES][64])
+		{
+			// the tables are written from white's point of view with A8 first
+			for (Square sq = A1; sq <= H8; sq++) {
+				Score white_score(pst[MG][sq ^ 56] + piece_values[MG][piece], pst[EG][sq ^ 56] + piece_values[EG][piece]);
+				Score black_score(pst[MG][sq] + piece_values[MG][piece], pst[EG][sq] + piece_values[EG][piece]);
+				PST[WHITE][piece][sq] = white_score;
+				PST[BLACK][piece][sq] = -black_score;
+			}
+		}
 
-				for (int j = 0; j < 8; j++) {
-					out_params[768 + i * 8 + j] = isolated_penalty[i][j];
+		static void WriteTable(FILE* file_stream, const char* name, const int* values, int size)
+		{
+			fprintf(file_stream, "inline constexpr int %s[NUM_PHASES][%d] = {\n", name, size);
+			for (int phase = 0; phase < NUM_PHASES; phase++) {
+				fprintf(file_stream, "\t{");
+				for (int i = 0; i < size; i++) {
+					if (size > 8 && i % 8 == 0)
+						fprintf(file_stream, "\n\t\t");
+					else if (i > 0)
+						fprintf(file_stream, " ");
+					fprintf(file_stream, i + 1 < size ? "%d," : "%d", values[phase * size + i]);
 				}
+				fprintf(file_stream, size > 8 ? "\n\t}%s\n" : "}%s\n", phase + 1 < NUM_PHASES ? "," : "");
 			}
+			fprintf(file_stream, "};\n\n");
+		}
+	};
 
-			out_params[784] = bishop_pair_bonus[0];
-			out_params[785] = bishop_pair_bonus[1];
-			out_params[786] = tempo_bonus;
+	#ifdef EVAL_TUNING
+	extern EvalParams g_eval_params;
+	#else
+	inline constexpr EvalParams g_eval_params;
+	#endif
+
+	#ifdef EVAL_TUNING
+	/* Coefficients of the tuned terms in one evaluation, filled by TraceEvaluation. A term is one entry of a table
+	* in ANKA_EVAL_TABLES and its coefficient is the number of times it is added for white minus for black.
+	* Apart from the endgame scaling and the rounding, the white relative evaluation is linear in the parameters:
+	*   mg = sum(coefficient * mg param), eg = sum(coefficient * eg param) * scale / SCALE_NORMAL
+	*   eval = (mg * (256 - phase) + eg * phase) / 256 +- tempo_bonus
+	* so the tuner can evaluate positions and compute gradients without the board.
+	*/
+	struct EvalTrace {
+		#define ANKA_TABLE_ID(name, size, first, last) name,
+		enum Table { ANKA_EVAL_TABLES(ANKA_TABLE_ID) NUM_TABLES };
+		#undef ANKA_TABLE_ID
+
+		#define ANKA_TABLE_FIRST(name, size, first, last) (first),
+		#define ANKA_TABLE_SIZE(name, size, first, last) (last) - (first),
+		static constexpr int table_first[NUM_TABLES] = { ANKA_EVAL_TABLES(ANKA_TABLE_FIRST) };
+		static constexpr int table_size[NUM_TABLES] = { ANKA_EVAL_TABLES(ANKA_TABLE_SIZE) };
+		#undef ANKA_TABLE_FIRST
+		#undef ANKA_TABLE_SIZE
+
+		static constexpr int TableOffset(int table)
+		{
+			int offset = 0;
+			for (int i = 0; i < table; i++)
+				offset += table_size[i];
+			return offset;
 		}
-	
-#endif
 
+		#define ANKA_COUNT_TERMS(name, size, first, last) + ((last) - (first))
+		static constexpr int NUM_TERMS = 0 ANKA_EVAL_TABLES(ANKA_COUNT_TERMS);
+		#undef ANKA_COUNT_TERMS
 
-		#define WRITE_PST(pst_name, file_stream) \
-			do { fprintf(file_stream, "int " STRINGIFY(pst_name) "[64]{"); \
-			for (Square sq = A1; sq < H8; sq++) { \
-					if (sq % 8 == 0) fprintf(file_stream, "\n\t"); \
-					fprintf(file_stream, "%d, ", pst_name[sq]); \
-			} \
-			fprintf(file_stream, "%d\n};\n\n", pst_name[H8]); } while (0)
+		// Index of the mg (phase = MG) or eg parameter of a term in the flattened parameters
+		static constexpr int ParamIndex(int term, int phase)
+		{
+			int table = 0;
+			while (term >= TableOffset(table + 1))
+				table++;
+			return 2 * TableOffset(table) + phase * table_size[table] + (term - TableOffset(table));
+		}
+		static constexpr int TEMPO_PARAM_INDEX = 2 * NUM_TERMS;
 
+		static constexpr Table pst_tables[8] = { pawns_pst, pawns_pst, pawns_pst, knights_pst, bishops_pst, rooks_pst, queens_pst, king_pst };
 
-		#define WRITE_FEATURE(feature, file_stream) \
-			do {const int* p = feature[MG]; \
-			fprintf(file_stream, "int " STRINGIFY(feature) "[NUM_PHASES][8] = {\n\t"); \
-			fprintf(file_stream, "{%d, %d, %d, %d, %d, %d, %d, %d},\n\t", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]); \
-			p = feature[EG]; \
-			fprintf(file_stream, "{%d, %d, %d, %d, %d, %d, %d, %d}\n};\n\n", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]); } while (0)
+		int coefficients[NUM_TERMS];
+		int phase; // 0 at the beginning, 256 in the endgame
+		int scale; // endgame scale factor, out of SCALE_NORMAL
+		int tempo; // 1 if white is to move, -1 if black is
+		bool fixed; // known endgame, 'fixed_eval' is the white relative evaluation and there are no terms
+		int fixed_eval;
 
-		void WriteParamsToFile(const char *file_name)
+		// Adds 'coefficient' to entry 'i' of 'table'. Entries that aren't tuned are ignored
+		void Add(Table table, int i, int coefficient)
 		{
-			FILE* file_stream = fopen(file_name, "w");
-			if (file_stream == NULL) {
-				fprintf(stderr, "Failed to open %s\n", file_name);
-				return;
-			}
-
-			fprintf(file_stream, "// ***Generated by the evaluation tuner***\n");
-			WRITE_FEATURE(piece_values, file_stream);
-			WRITE_FEATURE(mobility_weights, file_stream);
-			WRITE_FEATURE(passed_bonus, file_stream);
-			WRITE_FEATURE(isolated_penalty, file_stream);
-
-			fprintf(file_stream, "int bishop_pair_bonus[NUM_PHASES] = { %d, %d };\n", bishop_pair_bonus[0], bishop_pair_bonus[1]);
+			if (i >= table_first[table] && i < table_first[table] + table_size[table])
+				coefficients[TableOffset(table) + i - table_first[table]] += coefficient;
+		}
+	};
 
-			fprintf(file_stream, "int tempo_bonus = %d;\n\n", tempo_bonus);
+	static_assert(2 * EvalTrace::NUM_TERMS + 1 == EvalParams::NUM_PARAMS, "EvalTrace: tempo_bonus must be the only scalar parameter");
 
-			WRITE_PST(pawns_pst_mg, file_stream);
-			WRITE_PST(pawns_pst_eg, file_stream);
+	// set by TraceEvaluation while the calling thread evaluates a position
+	inline thread_local EvalTrace* g_eval_trace = nullptr;
 
-			WRITE_PST(knights_pst_mg, file_stream);
-			WRITE_PST(knights_pst_eg, file_stream);
+	// Evaluates 'pos' like ClassicalEvaluation and records the coefficients of the tuned terms in 'trace'
+	int TraceEvaluation(const GameState& pos, EvalTrace& trace);
 
-			WRITE_PST(bishops_pst_mg, file_stream);
-			WRITE_PST(bishops_pst_eg, file_stream);
+	#define TRACE(x) \
+		do { if (g_eval_trace) g_eval_trace->x; } while (0)
+	#else
+	#define TRACE(x)
+	#endif
 
-			WRITE_PST(rooks_pst_mg, file_stream);
-			WRITE_PST(rooks_pst_eg, file_stream);
+	// the lazy evaluation skips the expensive terms if the estimate is further than this outside the window
+	inline int g_lazy_eval_margin = EngineSettings::DEFAULT_LAZY_EVAL_MARGIN;
 
-			WRITE_PST(queens_pst_mg, file_stream);
-			WRITE_PST(queens_pst_eg, file_stream);
+	// Compares the set-wise pawn structure of both sides with a per pawn reference.
+	// Returns the number of sides with a mismatching set.
+	int CheckPawnSets(const GameState& pos);
 
-			WRITE_PST(king_pst_mg, file_stream);
-			WRITE_PST(king_pst_eg, file_stream);
-			
+	// Clears the evaluation cache of the calling thread
+	void ClearEvalCache();
 
-			fclose(file_stream);
-			#undef WRITE_FEATURE
-			#undef WRITE_PST		
-		}
-	};
-	
-	extern EvalParams g_eval_params;
+	#ifdef STATS_ENABLED
+	// Prints the evaluation cache statistics of the calling thread
+	void PrintEvalStatistics();
+	#endif
 }
\ No newline at end of file
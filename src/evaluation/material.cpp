@@ -0,0 +1,70 @@
+#include "material.hpp"
+#include "evaluation.hpp"
+
+namespace anka {
+	void EvaluateMaterial(const GameState& pos, MaterialEntry& entry)
+	{
+		int counts[NUM_SIDES][8]{};
+		int non_pawn_material[NUM_SIDES]{};
+		for (Side color = WHITE; color <= BLACK; color++) {
+			Bitboard pieces = color == WHITE ? pos.WhitePieces() : pos.BlackPieces();
+			while (pieces) {
+				PieceType piece = pos.GetPiece(bitboard::BitScanForward(pieces));
+				counts[color][piece]++;
+				if (piece != PAWN)
+					non_pawn_material[color] += g_eval_params.piece_values[MG][piece];
+				pieces &= pieces - 1;
+			}
+		}
+
+		entry.key = pos.MaterialKey();
+		entry.eval_func = nullptr;
+		entry.scale_func = nullptr;
+		entry.strong_side = WHITE;
+
+		// Map phase to [0-256]
+		int phase = MAX_PHASE - pos.PhaseMaterial();
+		entry.phase = static_cast<i16>(((phase << 8) + (MAX_PHASE >> 1)) / MAX_PHASE); // (phase * 256 + (MAX_PHASE / 2)) / MAX_PHASE
+
+		// bishop pair bonus
+		entry.imbalance = Score();
+		if (counts[WHITE][BISHOP] > 1) {
+			entry.imbalance += g_eval_params.bishop_pair;
+			TRACE(Add(EvalTrace::bishop_pair_bonus, 0, 1));
+		}
+		if (counts[BLACK][BISHOP] > 1) {
+			entry.imbalance -= g_eval_params.bishop_pair;
+			TRACE(Add(EvalTrace::bishop_pair_bonus, 0, -1));
+		}
+
+		// a side without pawns needs more than a minor piece advantage to win
+		int minor_value = Max(g_eval_params.piece_values[MG][KNIGHT], g_eval_params.piece_values[MG][BISHOP]);
+		for (Side us = WHITE; us <= BLACK; us++) {
+			Side them = us ^ 1;
+			entry.scale[us] = SCALE_NORMAL;
+			if (counts[us][PAWN] == 0 && non_pawn_material[us] - non_pawn_material[them] <= minor_value) {
+				entry.scale[us] = non_pawn_material[us] < g_eval_params.piece_values[MG][ROOK] ? SCALE_DRAW
+					: non_pawn_material[them] <= minor_value ? 4 : 14;
+			}
+		}
+
+		const Endgame* endgame = FindEndgame(entry.key);
+		if (endgame) {
+			entry.eval_func = endgame->eval;
+			entry.scale_func = endgame->scale;
+			entry.strong_side = endgame->strong_side;
+			return;
+		}
+
+		// other winning material vs lone king, such as pieces with pawns or a promoted third queen
+		for (Side us = WHITE; us <= BLACK; us++) {
+			Side them = us ^ 1;
+			bool lone_king = counts[them][PAWN] == 0 && non_pawn_material[them] == 0;
+			if (lone_king && non_pawn_material[us] >= g_eval_params.piece_values[MG][ROOK]) {
+				entry.eval_func = endgame::EvaluateKXK;
+				entry.strong_side = us;
+				return;
+			}
+		}
+	}
+}
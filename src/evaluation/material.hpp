@@ -0,0 +1,85 @@
+#pragma once
+#include "core.hpp"
+#include "boarddefs.hpp"
+#include "endgame.hpp"
+#include "gamestate.hpp"
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+namespace anka {
+	// Evaluation terms that only depend on the piece counts
+	struct MaterialEntry {
+		u64 key;
+		EndgameEval eval_func; // nullptr if the position isn't a known endgame
+		EndgameScale scale_func; // optional, refines 'scale' using the piece placement
+		Score imbalance; // bishop pair bonus, white - black
+		i16 phase; // 0 at the beginning, 256 in the endgame
+		byte scale[NUM_SIDES]; // endgame scale factor of each side when it is ahead
+		Side strong_side; // for eval_func
+
+		force_inline int ScaleFactor(const GameState& pos, Side side) const
+		{
+			int scale_factor = scale[side];
+			if (scale_func)
+				scale_factor = Min(scale_factor, scale_func(pos, side));
+			return scale_factor;
+		}
+	};
+
+	// Computes the material entry of the position
+	void EvaluateMaterial(const GameState& pos, MaterialEntry& entry);
+
+	/* Material entries indexed by the material key. There are few different piece
+	* configurations in a search, so a small table is enough.
+	* Each search thread has its own table, so there is no locking.
+	*/
+	class MaterialTable {
+	public:
+		static constexpr size_t NUM_ENTRIES = 4096; // 192 KiB
+
+		MaterialTable() { Clear(); }
+
+		// Returns the entry of the position, evaluating it on a miss
+		force_inline const MaterialEntry* Probe(const GameState& pos)
+		{
+			u64 material_key = pos.MaterialKey();
+			MaterialEntry* entry = &m_entries[material_key & (NUM_ENTRIES - 1)];
+			STATS(m_num_queries++);
+			if (entry->key == material_key) {
+				STATS(m_num_hits++);
+				return entry;
+			}
+
+			EvaluateMaterial(pos, *entry);
+			return entry;
+		}
+
+		void Clear()
+		{
+			memset(m_entries, 0, sizeof(m_entries));
+			// 0 is the key of KvK
+			for (size_t i = 0; i < NUM_ENTRIES; i++) {
+				m_entries[i].key = ~C64(0);
+			}
+			STATS(m_num_queries = 0);
+			STATS(m_num_hits = 0);
+		}
+
+		#ifdef STATS_ENABLED
+		void PrintStatistics() const
+		{
+			printf("\nMATERIAL TABLE STATISTICS\n");
+			printf("Hit rate: %.4f (%" PRIu64 " / %" PRIu64 ")\n",
+				m_num_hits / static_cast<double>(m_num_queries), m_num_hits, m_num_queries);
+		}
+		#endif
+	private:
+		MaterialEntry m_entries[NUM_ENTRIES];
+
+		#ifdef STATS_ENABLED
+		u64 m_num_queries = 0;
+		u64 m_num_hits = 0;
+		#endif
+	};
+}
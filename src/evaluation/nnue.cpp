@@ -0,0 +1,389 @@
+#include "nnue.hpp"
+#include "gamestate.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <new>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/* Network file format, all values little endian:
+*	char magic[8] = "ANKANNUE"
+*	u32 version, num_features, ft_size, l1_size, l2_size
+*	i16 ft_biases[ft_size]
+*	i16 ft_weights[num_features][ft_size]
+*	i32 l1_biases[l1_size]
+*	i8  l1_weights[l1_size][2 * ft_size]
+*	i32 l2_biases[l2_size]
+*	i8  l2_weights[l2_size][l1_size]
+*	i32 output_bias
+*	i8  output_weights[l2_size]
+*/
+
+namespace anka {
+	namespace nnue {
+		namespace {
+			constexpr char NETWORK_MAGIC[8] = { 'A', 'N', 'K', 'A', 'N', 'N', 'U', 'E' };
+			constexpr u32 NETWORK_VERSION = 1;
+			constexpr int WEIGHT_SHIFT = 6; // hidden layer weights are scaled by 64
+			constexpr int OUTPUT_SCALE = 16; // network output units per centipawn
+			constexpr int ACTIVATION_MAX = 127;
+
+			// each array is aligned for the SIMD loads
+			struct Network {
+				alignas(64) i16 ft_biases[FT_SIZE];
+				alignas(64) i16 ft_weights[NUM_FEATURES][FT_SIZE];
+				alignas(64) i32 l1_biases[L1_SIZE];
+				alignas(64) i8 l1_weights[L1_SIZE][2 * FT_SIZE];
+				alignas(64) i32 l2_biases[L2_SIZE];
+				alignas(64) i8 l2_weights[L2_SIZE][L1_SIZE];
+				alignas(64) i32 output_bias;
+				alignas(64) i8 output_weights[L2_SIZE];
+			};
+
+			Network* network = nullptr;
+			u32 network_generation = 1; // changes with every load and unload, zero-initialized accumulators never match
+
+			force_inline int FeatureIndex(Side perspective, Square king_sq, PieceType piece, Side piece_side, Square sq)
+			{
+				int flip = perspective == WHITE ? 0 : 56;
+				int piece_index = (piece - PAWN) * 2 + (piece_side != perspective);
+				return ((king_sq ^ flip) * 10 + piece_index) * 64 + (sq ^ flip);
+			}
+
+			// SIMD kernels
+
+			force_inline void AddWeights(i16* acc, const i16* weights)
+			{
+			#if defined(__AVX2__)
+				for (int i = 0; i < FT_SIZE; i += 16) {
+					__m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+					__m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+					_mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi16(a, w));
+				}
+			#elif defined(__SSSE3__)
+				for (int i = 0; i < FT_SIZE; i += 8) {
+					__m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+					__m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+					_mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi16(a, w));
+				}
+			#else
+				for (int i = 0; i < FT_SIZE; i++) {
+					acc[i] += weights[i];
+				}
+			#endif
+			}
+
+			force_inline void SubWeights(i16* acc, const i16* weights)
+			{
+			#if defined(__AVX2__)
+				for (int i = 0; i < FT_SIZE; i += 16) {
+					__m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+					__m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+					_mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi16(a, w));
+				}
+			#elif defined(__SSSE3__)
+				for (int i = 0; i < FT_SIZE; i += 8) {
+					__m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+					__m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+					_mm_store_si128(reinterpret_cast<__m128i*>(acc + i), _mm_sub_epi16(a, w));
+				}
+			#else
+				for (int i = 0; i < FT_SIZE; i++) {
+					acc[i] -= weights[i];
+				}
+			#endif
+			}
+
+			// Clamps the accumulator values to [0, 127]
+			force_inline void ClippedReLU16(const i16* input, byte* output, int size)
+			{
+			#if defined(__AVX2__)
+				const __m256i max = _mm256_set1_epi16(ACTIVATION_MAX);
+				for (int i = 0; i < size; i += 32) {
+					__m256i a = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(input + i)), max);
+					__m256i b = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(input + i + 16)), max);
+					// packus saturates negative values to 0 but interleaves the 128-bit lanes
+					__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(output + i), packed);
+				}
+			#elif defined(__SSSE3__)
+				const __m128i max = _mm_set1_epi16(ACTIVATION_MAX);
+				for (int i = 0; i < size; i += 16) {
+					__m128i a = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(input + i)), max);
+					__m128i b = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(input + i + 8)), max);
+					_mm_store_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(a, b));
+				}
+			#else
+				for (int i = 0; i < size; i++) {
+					output[i] = static_cast<byte>(Clamp<int>(input[i], 0, ACTIVATION_MAX));
+				}
+			#endif
+			}
+
+			// Dot product of 'size' unsigned 8-bit activations and signed 8-bit weights. 'size' is a multiple of 32
+			force_inline int DotProduct(const byte* input, const i8* weights, int size)
+			{
+			#if defined(__AVX2__)
+				const __m256i ones = _mm256_set1_epi16(1);
+				__m256i sum = _mm256_setzero_si256();
+				for (int i = 0; i < size; i += 32) {
+					__m256i in = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + i));
+					__m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+					// 127 * 127 * 2 fits in an i16, no saturation
+					__m256i products = _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones);
+					sum = _mm256_add_epi32(sum, products);
+				}
+				__m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+				sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+				sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+				return _mm_cvtsi128_si32(sum128);
+			#elif defined(__SSSE3__)
+				const __m128i ones = _mm_set1_epi16(1);
+				__m128i sum = _mm_setzero_si128();
+				for (int i = 0; i < size; i += 16) {
+					__m128i in = _mm_load_si128(reinterpret_cast<const __m128i*>(input + i));
+					__m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+					__m128i products = _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones);
+					sum = _mm_add_epi32(sum, products);
+				}
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+				return _mm_cvtsi128_si32(sum);
+			#else
+				int sum = 0;
+				for (int i = 0; i < size; i++) {
+					sum += input[i] * weights[i];
+				}
+				return sum;
+			#endif
+			}
+
+			// Hidden layer with clipped ReLU activation
+			template <int in_size, int out_size>
+			force_inline void AffineReLU(const byte* input, const i8 (*weights)[in_size], const i32* biases, byte* output)
+			{
+				for (int i = 0; i < out_size; i++) {
+					int sum = biases[i] + DotProduct(input, weights[i], in_size);
+					output[i] = static_cast<byte>(Clamp(sum >> WEIGHT_SHIFT, 0, ACTIVATION_MAX));
+				}
+			}
+
+			template <typename T>
+			bool Read(FILE* file, T* data, size_t count)
+			{
+				return fread(data, sizeof(T), count, file) == count;
+			}
+		}
+
+		bool LoadNetwork(const char* path)
+		{
+			FILE* file = fopen(path, "rb");
+			if (!file) {
+				fprintf(stderr, "AnkaError(NNUE): Failed to open %s\n", path);
+				return false;
+			}
+
+			char magic[sizeof(NETWORK_MAGIC)];
+			u32 header[5];
+			const u32 expected_header[5] = { NETWORK_VERSION, NUM_FEATURES, FT_SIZE, L1_SIZE, L2_SIZE };
+			bool ok = Read(file, magic, sizeof(magic))
+				&& memcmp(magic, NETWORK_MAGIC, sizeof(NETWORK_MAGIC)) == 0
+				&& Read(file, header, 5)
+				&& memcmp(header, expected_header, sizeof(header)) == 0;
+
+			Network* net = ok ? new (std::nothrow) Network : nullptr;
+			if (ok && !net) {
+				fprintf(stderr, "AnkaError(NNUE): Failed to allocate network memory\n");
+				fclose(file);
+				return false;
+			}
+
+			ok = ok && Read(file, net->ft_biases, FT_SIZE)
+				&& Read(file, &net->ft_weights[0][0], static_cast<size_t>(NUM_FEATURES) * FT_SIZE)
+				&& Read(file, net->l1_biases, L1_SIZE)
+				&& Read(file, &net->l1_weights[0][0], L1_SIZE * 2 * FT_SIZE)
+				&& Read(file, net->l2_biases, L2_SIZE)
+				&& Read(file, &net->l2_weights[0][0], L2_SIZE * L1_SIZE)
+				&& Read(file, &net->output_bias, 1)
+				&& Read(file, net->output_weights, L2_SIZE);
+
+			char extra;
+			ok = ok && fread(&extra, 1, 1, file) == 0;
+			fclose(file);
+
+			if (!ok) {
+				fprintf(stderr, "AnkaError(NNUE): %s is not a valid network file\n", path);
+				delete net;
+				return false;
+			}
+
+			delete network;
+			network = net;
+			network_generation++;
+			return true;
+		}
+
+		void UnloadNetwork()
+		{
+			delete network;
+			network = nullptr;
+			network_generation++;
+		}
+
+		bool NetworkLoaded()
+		{
+			return network != nullptr;
+		}
+
+		const char* SimdName()
+		{
+		#if defined(__AVX2__)
+			return "AVX2";
+		#elif defined(__SSSE3__)
+			return "SSSE3";
+		#else
+			return "scalar";
+		#endif
+		}
+	}
+
+	int GameState::Evaluate() const
+	{
+	#ifndef EVAL_TUNING
+		if (nnue::network)
+			return NnueEvaluation();
+	#endif
+		return ClassicalEvaluation();
+	}
+
+	int GameState::Evaluate(int alpha, int beta) const
+	{
+	#ifndef EVAL_TUNING
+		if (nnue::network)
+			return NnueEvaluation();
+	#endif
+		return ClassicalEvaluation(alpha, beta);
+	}
+
+#ifndef EVAL_TUNING
+	void GameState::RefreshAccumulator(nnue::Accumulator& acc, Side perspective) const
+	{
+		const nnue::Network& net = *nnue::network;
+		Square king_sq = bitboard::BitScanForward(m_piecesBB[KING] & m_piecesBB[perspective]);
+		i16* values = acc.values[perspective];
+		memcpy(values, net.ft_biases, sizeof(net.ft_biases));
+
+		Bitboard pieces = m_occupation & ~m_piecesBB[KING];
+		while (pieces) {
+			Square sq = bitboard::BitScanForward(pieces);
+			Side piece_side = bitboard::BitIsSet(m_piecesBB[WHITE], sq) ? WHITE : BLACK;
+			int index = nnue::FeatureIndex(perspective, king_sq, m_board[sq], piece_side, sq);
+			nnue::AddWeights(values, net.ft_weights[index]);
+			pieces &= pieces - 1;
+		}
+	}
+
+	/* Brings the accumulator of the current ply up to date. For each perspective, the search walks back
+	* to the latest ply with a computed accumulator and applies the pieces that changed since then.
+	* A move of the perspective's own king changes every feature, so the accumulator is refreshed from the board.
+	*/
+	const nnue::Accumulator& GameState::UpdateAccumulator() const
+	{
+		if (!m_accumulators)
+			m_accumulators = new nnue::Accumulator[kStateHistoryMaxSize]();
+
+		const nnue::Network& net = *nnue::network;
+		const u32 generation = nnue::network_generation;
+		auto key_at = [this](int ply) {
+			return ply == m_ply ? m_zobrist_key : m_key_history[m_root_ply_index + ply];
+		};
+		auto is_valid = [&](int ply, Side perspective) {
+			return m_accumulators[ply].key[perspective] == key_at(ply) && m_accumulators[ply].generation[perspective] == generation;
+		};
+
+		for (Side perspective = WHITE; perspective <= BLACK; perspective++) {
+			if (is_valid(m_ply, perspective))
+				continue;
+
+			int base = m_ply;
+			bool refresh = false;
+			while (!is_valid(base, perspective)) {
+				if (base == 0) {
+					refresh = true;
+					break;
+				}
+
+				const nnue::DirtyPieces& dirty = m_state_history[base - 1].dirty_pieces;
+				if (dirty.num > 0 && dirty.piece[0] == KING && dirty.side[0] == perspective) {
+					refresh = true;
+					break;
+				}
+				base--;
+			}
+
+			if (refresh) {
+				RefreshAccumulator(m_accumulators[m_ply], perspective);
+				m_accumulators[m_ply].key[perspective] = m_zobrist_key;
+				m_accumulators[m_ply].generation[perspective] = generation;
+				continue;
+			}
+
+			// the perspective's king hasn't moved since 'base'
+			Square king_sq = bitboard::BitScanForward(m_piecesBB[KING] & m_piecesBB[perspective]);
+			for (int ply = base + 1; ply <= m_ply; ply++) {
+				i16* values = m_accumulators[ply].values[perspective];
+				memcpy(values, m_accumulators[ply - 1].values[perspective], sizeof(m_accumulators[ply].values[perspective]));
+
+				const nnue::DirtyPieces& dirty = m_state_history[ply - 1].dirty_pieces;
+				for (int i = 0; i < dirty.num; i++) {
+					if (dirty.piece[i] == KING)
+						continue;
+					if (dirty.from[i] != NO_SQUARE)
+						nnue::SubWeights(values, net.ft_weights[nnue::FeatureIndex(perspective, king_sq, dirty.piece[i], dirty.side[i], dirty.from[i])]);
+					if (dirty.to[i] != NO_SQUARE)
+						nnue::AddWeights(values, net.ft_weights[nnue::FeatureIndex(perspective, king_sq, dirty.piece[i], dirty.side[i], dirty.to[i])]);
+				}
+
+				m_accumulators[ply].key[perspective] = key_at(ply);
+				m_accumulators[ply].generation[perspective] = generation;
+			}
+		}
+
+		#ifdef ANKA_DEBUG
+		nnue::Accumulator fresh;
+		for (Side perspective = WHITE; perspective <= BLACK; perspective++) {
+			RefreshAccumulator(fresh, perspective);
+			ANKA_ASSERT(memcmp(fresh.values[perspective], m_accumulators[m_ply].values[perspective], sizeof(fresh.values[perspective])) == 0);
+		}
+		#endif
+
+		return m_accumulators[m_ply];
+	}
+
+	// Evaluates the position from side to play's perspective.
+	// Returns a score in centipawns.
+	int GameState::NnueEvaluation() const
+	{
+		const nnue::Network& net = *nnue::network;
+		const nnue::Accumulator& acc = UpdateAccumulator();
+
+		alignas(64) byte transformed[2 * nnue::FT_SIZE];
+		alignas(64) byte l1_output[nnue::L1_SIZE];
+		alignas(64) byte l2_output[nnue::L2_SIZE];
+
+		// side to move's perspective first
+		nnue::ClippedReLU16(acc.values[m_side], transformed, nnue::FT_SIZE);
+		nnue::ClippedReLU16(acc.values[m_side ^ 1], transformed + nnue::FT_SIZE, nnue::FT_SIZE);
+
+		nnue::AffineReLU<2 * nnue::FT_SIZE, nnue::L1_SIZE>(transformed, net.l1_weights, net.l1_biases, l1_output);
+		nnue::AffineReLU<nnue::L1_SIZE, nnue::L2_SIZE>(l1_output, net.l2_weights, net.l2_biases, l2_output);
+		int output = net.output_bias + nnue::DotProduct(l2_output, net.output_weights, nnue::L2_SIZE);
+
+		return Clamp(output / nnue::OUTPUT_SCALE, LOWER_MATE_THRESHOLD + 1, UPPER_MATE_THRESHOLD - 1);
+	}
+#endif
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "core.hpp"
+#include "boarddefs.hpp"
+
+namespace anka {
+	namespace nnue {
+		/* HalfKP network: for each perspective, the input features are (own king square, piece type and
+		* color, piece square) for all pieces except the kings. Black's perspective is mirrored vertically,
+		* so each side sees its pieces as white pieces.
+		*
+		* 2 x 40960 -> 2 x 256 (feature transformer, shared weights) -> 32 -> 32 -> 1
+		*
+		* The feature transformer outputs are kept in accumulators that are updated with the pieces
+		* that changed in each move. The hidden layers use int8 weights and clipped ReLU activations.
+		*/
+		inline constexpr int NUM_FEATURES = 64 * 10 * 64;
+		inline constexpr int FT_SIZE = 256; // feature transformer outputs per perspective
+		inline constexpr int L1_SIZE = 32;
+		inline constexpr int L2_SIZE = 32;
+		inline constexpr int MAX_DIRTY_PIECES = 3;
+
+		// Pieces that changed with a move. 'from' is NO_SQUARE for an added piece, 'to' is NO_SQUARE for a removed one.
+		struct DirtyPieces {
+			byte num;
+			byte piece[MAX_DIRTY_PIECES];
+			byte side[MAX_DIRTY_PIECES];
+			byte from[MAX_DIRTY_PIECES];
+			byte to[MAX_DIRTY_PIECES];
+
+			force_inline void Add(PieceType p, Side s, Square from_sq, Square to_sq)
+			{
+				piece[num] = static_cast<byte>(p);
+				side[num] = static_cast<byte>(s);
+				from[num] = static_cast<byte>(from_sq);
+				to[num] = static_cast<byte>(to_sq);
+				num++;
+			}
+		};
+
+		// Feature transformer outputs of a position. 'key' is the position key the perspective was computed for,
+		// 'generation' the network it was computed with.
+		struct alignas(64) Accumulator {
+			i16 values[NUM_SIDES][FT_SIZE];
+			u64 key[NUM_SIDES];
+			u32 generation[NUM_SIDES];
+		};
+
+		// Loads a network file (format described in nnue.cpp). Returns false and keeps the current network on failure
+		bool LoadNetwork(const char* path);
+		void UnloadNetwork();
+		bool NetworkLoaded();
+
+		// Name of the SIMD kernels the engine was compiled with
+		const char* SimdName();
+	}
+}
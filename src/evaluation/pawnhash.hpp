@@ -0,0 +1,62 @@
+#pragma once
+#include "core.hpp"
+#include "boarddefs.hpp"
+#include "bitboard.hpp"
+#include "score.hpp"
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+namespace anka {
+	// Each entry is 32 bytes
+	struct PawnEntry {
+		u64 key;
+		Bitboard passed_pawns[NUM_SIDES];
+		Score score; // passed and isolated pawn terms, white - black
+		u32 unused;
+	};
+	static_assert(sizeof(PawnEntry) == 32, "PawnEntry: unexpected struct alignment");
+
+	/* Caches the evaluation terms that only depend on the pawn structure, indexed by the pawn key.
+	* The pawn structure rarely changes between sibling nodes so the hit rate is high even with a small table.
+	* Each search thread has its own table, so there is no locking.
+	*/
+	class PawnHashTable {
+	public:
+		static constexpr size_t NUM_ENTRIES = 16384; // 512 KiB
+
+		// Returns the entry for 'pawn_key'. 'hit' is false if the entry belongs to another pawn structure
+		force_inline PawnEntry* Probe(u64 pawn_key, bool& hit)
+		{
+			PawnEntry* entry = &m_entries[pawn_key & (NUM_ENTRIES - 1)];
+			hit = entry->key == pawn_key;
+			STATS(m_num_queries++);
+			STATS(m_num_hits += hit);
+			return entry;
+		}
+
+		void Clear()
+		{
+			memset(m_entries, 0, sizeof(m_entries));
+			STATS(m_num_queries = 0);
+			STATS(m_num_hits = 0);
+		}
+
+		#ifdef STATS_ENABLED
+		void PrintStatistics() const
+		{
+			printf("\nPAWN HASH TABLE STATISTICS\n");
+			printf("Hit rate: %.4f (%" PRIu64 " / %" PRIu64 ")\n",
+				m_num_hits / static_cast<double>(m_num_queries), m_num_hits, m_num_queries);
+		}
+		#endif
+	private:
+		// a zeroed entry is valid for the position without pawns
+		PawnEntry m_entries[NUM_ENTRIES]{};
+
+		#ifdef STATS_ENABLED
+		u64 m_num_queries = 0;
+		u64 m_num_hits = 0;
+		#endif
+	};
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "core.hpp"
+
+namespace anka {
+	/* Middle game and end game values packed into one 32-bit integer, the end game value in the upper 16 bits.
+	* Both halves are added, subtracted and multiplied by an integer with a single operation, so the
+	* evaluation terms need one table lookup and one sum instead of two. Each half must stay in the i16 range.
+	*/
+	class Score {
+	public:
+		Score() = default; // uninitialized like an int, Score() or Score{} is zero
+		constexpr Score(int mg, int eg) : m_value(static_cast<i32>((static_cast<u32>(eg) << 16) + static_cast<u32>(mg))) {}
+
+		constexpr int Mg() const { return static_cast<i16>(static_cast<u16>(static_cast<u32>(m_value))); }
+		// rounds up to undo the borrow of a negative middle game value
+		constexpr int Eg() const { return static_cast<i16>(static_cast<u16>((static_cast<u32>(m_value) + 0x8000) >> 16)); }
+
+		constexpr Score operator+(Score other) const { return FromRaw(static_cast<u32>(m_value) + static_cast<u32>(other.m_value)); }
+		constexpr Score operator-(Score other) const { return FromRaw(static_cast<u32>(m_value) - static_cast<u32>(other.m_value)); }
+		constexpr Score operator-() const { return FromRaw(0u - static_cast<u32>(m_value)); }
+		constexpr Score operator*(int factor) const { return FromRaw(static_cast<u32>(m_value) * static_cast<u32>(factor)); }
+		constexpr Score& operator+=(Score other) { return *this = *this + other; }
+		constexpr Score& operator-=(Score other) { return *this = *this - other; }
+		constexpr bool operator==(Score other) const { return m_value == other.m_value; }
+		constexpr bool operator!=(Score other) const { return m_value != other.m_value; }
+
+		// Interpolates between the middle game and end game values. 'phase' is 0 at the beginning, 256 in the endgame.
+		constexpr int Taper(int phase) const { return ((Mg() * (256 - phase)) + (Eg() * phase)) >> 8; }
+	private:
+		static constexpr Score FromRaw(u32 value)
+		{
+			Score score{};
+			score.m_value = static_cast<i32>(value);
+			return score;
+		}
+
+		i32 m_value;
+	};
+	static_assert(sizeof(Score) == 4, "Score: unexpected size");
+}
@@ -1,5 +1,6 @@
 #include "gamestate.hpp"
 #include "movegen.hpp"
+#include "packedpos.hpp"
 #include <sstream>
 #include <inttypes.h>
 #include <ctype.h>
@@ -24,10 +25,33 @@ void anka::GameState::Clear()
 	m_halfmove_clock = 0;
 	m_side = NOSIDE;
 	m_zobrist_key = C64(0);
+	m_pawn_key = C64(0);
+	m_material_key = C64(0);
+	m_psqt = Score();
+	m_phase_material = 0;
 	m_ply = 0;
 	m_root_ply_index = 0;
 }
 
+void anka::GameState::CopyFrom(const GameState& other)
+{
+	PositionRecord* state_history = m_state_history;
+	u64* key_history = m_key_history;
+	nnue::Accumulator* accumulators = m_accumulators;
+
+	// member-wise copy, then point back to our own history buffers
+	*this = other;
+	m_state_history = state_history;
+	m_key_history = key_history;
+	m_accumulators = accumulators; // accumulators are recomputed when needed
+
+	#ifndef EVAL_TUNING
+	int num_records = Min(m_root_ply_index + m_ply + 1, kStateHistoryMaxSize);
+	memcpy(m_state_history, other.m_state_history, num_records * sizeof(PositionRecord));
+	memcpy(m_key_history, other.m_key_history, num_records * sizeof(u64));
+	#endif
+}
+
 
 bool anka::GameState::LoadPosition(std::string fen)
 {
@@ -165,6 +189,68 @@ bool anka::GameState::LoadPosition(std::string fen)
 
 	m_occupation = m_piecesBB[WHITE] | m_piecesBB[BLACK];
 	m_zobrist_key = CalculateKey();
+	m_pawn_key = CalculatePawnKey();
+	m_material_key = CalculateMaterialKey();
+	CalculatePSQT(m_psqt, m_phase_material);
+
+	ANKA_ASSERT(Validate());
+
+	return true;
+}
+
+bool anka::GameState::LoadPacked(const PackedPosition& packed)
+{
+	Clear();
+
+	// the pieces array has room for 32 piece codes
+	if (bitboard::PopCount(packed.occupancy) > 32) {
+		std::cerr << "AnkaError (LoadPacked): Too many pieces.\n";
+		return false;
+	}
+
+	if (packed.Result() > 2) {
+		std::cerr << "AnkaError (LoadPacked): Invalid game result.\n";
+		return false;
+	}
+
+	Bitboard occupancy = packed.occupancy;
+	for (int i = 0; occupancy; i++) {
+		Square sq = bitboard::BitScanForward(occupancy);
+		int code = (packed.pieces[i / 2] >> (4 * (i & 1))) & 15;
+		PieceType piece = code & 7;
+		if (piece < PAWN || piece > KING) {
+			std::cerr << "AnkaError (LoadPacked): Invalid piece code.\n";
+			return false;
+		}
+
+		bitboard::SetBit(m_piecesBB[piece], sq);
+		bitboard::SetBit(m_piecesBB[code >> 3], sq);
+		m_board[sq] = piece;
+		occupancy &= occupancy - 1;
+	}
+
+	// Validate only runs in debug builds and the evaluation assumes one king per side
+	Bitboard kings = m_piecesBB[KING];
+	if (bitboard::PopCount(kings & m_piecesBB[WHITE]) != 1 || bitboard::PopCount(kings & m_piecesBB[BLACK]) != 1) {
+		std::cerr << "AnkaError (LoadPacked): Each side must have one king.\n";
+		return false;
+	}
+
+	if (packed.ep_target != NO_SQUARE && packed.ep_target > H8) {
+		std::cerr << "AnkaError (LoadPacked): Invalid en passant square.\n";
+		return false;
+	}
+
+	m_side = packed.SideToPlay();
+	m_castling_rights = packed.castling_rights & (castle_wk | castle_wq | castle_bk | castle_bq);
+	m_ep_target = packed.ep_target;
+	m_halfmove_clock = packed.halfmove_clock;
+
+	m_occupation = m_piecesBB[WHITE] | m_piecesBB[BLACK];
+	m_zobrist_key = CalculateKey();
+	m_pawn_key = CalculatePawnKey();
+	m_material_key = CalculateMaterialKey();
+	CalculatePSQT(m_psqt, m_phase_material);
 
 	ANKA_ASSERT(Validate());
 
@@ -6,25 +6,33 @@
 #include "hash.hpp"
 #include "attacks.hpp"
 #include "move.hpp"
+#include "nnue.hpp"
+#include "score.hpp"
 #include "util.hpp"
 #include <string>
 
 
 namespace anka {
 	constexpr int kStateHistoryMaxSize = 1024;
+	struct PackedPosition;
 
 	struct PositionRecord {
 		Move move_made;
 		int half_move_clock;
 		Square ep_target;
 		byte castle_rights;
+		Score psqt;
+		int phase_material;
+		u64 pawn_key;
+		u64 material_key;
+		nnue::DirtyPieces dirty_pieces; // pieces changed by move_made
 	};
 
 	class GameState {
 	public:
 		GameState() : m_piecesBB{}, m_occupation{}, m_board{}, m_ep_target{ NO_SQUARE },
 			m_side{ WHITE }, m_halfmove_clock{ 0 }, m_castling_rights{ 0 },
-			m_zobrist_key{}, m_root_ply_index{}, m_ply{}, m_state_history{}, m_key_history{}
+			m_zobrist_key{}, m_pawn_key{}, m_material_key{}, m_psqt{}, m_phase_material{}, m_root_ply_index{}, m_ply{}, m_state_history{}, m_key_history{}, m_accumulators{}
 		{
 			#ifndef EVAL_TUNING
 			m_key_history = new u64[kStateHistoryMaxSize];
@@ -37,6 +45,7 @@ namespace anka {
 			#ifndef EVAL_TUNING
 			delete[] m_key_history;
 			delete[] m_state_history;
+			delete[] m_accumulators;
 			#endif
 		}
 		
@@ -177,6 +186,8 @@ namespace anka {
 		force_inline int HalfMoveClock() const { return m_halfmove_clock; }
 		force_inline byte CastlingRights() const { return m_castling_rights; }
 		force_inline u64 PositionKey() const { return m_zobrist_key; }
+		force_inline u64 PawnKey() const { return m_pawn_key; }
+		force_inline u64 MaterialKey() const { return m_material_key; }
 		force_inline int Ply() const { return m_ply; }
 		force_inline Move LastMove() const { return m_state_history[m_ply - 1].move_made; }
 		force_inline void SetRootPlyIndex() 
@@ -186,6 +197,8 @@ namespace anka {
 		}
 
 		u64 CalculateKey();
+		u64 CalculatePawnKey() const;
+		u64 CalculateMaterialKey() const;
 
 		force_inline void UpdateKeyWithPiece(PieceType piece_type, Side piece_color, Square sq)
 		{
@@ -195,6 +208,21 @@ namespace anka {
 			m_zobrist_key ^= zobrist_keys::piece_keys[piece_color][piece_type - 2][sq];
 		}
 
+		// pawn moves change both keys
+		force_inline void UpdateKeysWithPawn(Side pawn_color, Square sq)
+		{
+			u64 pawn_key = zobrist_keys::piece_keys[pawn_color][PAWN - 2][sq];
+			m_zobrist_key ^= pawn_key;
+			m_pawn_key ^= pawn_key;
+		}
+
+		// The material key is the xor of the keys of the piece counts. 'index' is the count minus one
+		// after adding a piece, or the count after removing one.
+		force_inline void UpdateMaterialKey(PieceType piece_type, Side piece_color, int index)
+		{
+			m_material_key ^= zobrist_keys::piece_keys[piece_color][piece_type - 2][index];
+		}
+
 		force_inline void UpdateKeyWithCastle()
 		{
 			m_zobrist_key ^= zobrist_keys::castle_keys[m_castling_rights];
@@ -210,7 +238,20 @@ namespace anka {
 			m_zobrist_key ^= zobrist_keys::ep_keys[m_ep_target];
 		}
 
+		// Material + piece-square score (white - black) and the phase weight of the pieces on the board.
+		// Both are updated incrementally in MakeMove/UndoMove.
+		force_inline Score PSQTScore() const { return m_psqt; }
+		force_inline int PhaseMaterial() const { return m_phase_material; }
+		void CalculatePSQT(Score& psqt, int& phase_material) const;
+
+		// NNUE evaluation if a network is loaded, classical evaluation otherwise
+		int Evaluate() const;
+		// Same as Evaluate, but the classical evaluation may return a material + PST estimate
+		// when the estimate is far outside the (alpha, beta) window
+		int Evaluate(int alpha, int beta) const;
 		int ClassicalEvaluation() const;
+		int ClassicalEvaluation(int alpha, int beta) const;
+		int NnueEvaluation() const;
 
 		void MakeMove(Move move);
 		void UndoMove();
@@ -219,8 +260,10 @@ namespace anka {
 
 		bool Validate();
 		void Clear();
+		void CopyFrom(const GameState& other); // deep copy, including the move history
 		bool LoadStartPosition() { return LoadPosition("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"); }
 		bool LoadPosition(std::string fen);
+		bool LoadPacked(const PackedPosition& packed);
 		void ToFen(char* fen);
 
 		Move ParseMove(const char* line) const;
@@ -248,10 +291,21 @@ namespace anka {
 		int m_halfmove_clock;
 		byte m_castling_rights;
 		u64 m_zobrist_key;
+		u64 m_pawn_key; // zobrist key of the pawns only
+		u64 m_material_key; // zobrist key of the piece counts
+		Score m_psqt;
+		int m_phase_material;
 		PositionRecord *m_state_history;
 		u64 *m_key_history;
 		int m_root_ply_index;
 		int m_ply;
 
+		// NNUE accumulators indexed by ply. Allocated on the first NNUE evaluation
+		mutable nnue::Accumulator* m_accumulators;
+		const nnue::Accumulator& UpdateAccumulator() const;
+		void RefreshAccumulator(nnue::Accumulator& acc, Side perspective) const;
+
+		force_inline void AddPiecePSQT(PieceType piece_type, Side piece_color, Square sq);
+		force_inline void RemovePiecePSQT(PieceType piece_type, Side piece_color, Square sq);
 	};
 } // namespace anka
\ No newline at end of file
@@ -56,4 +56,36 @@ namespace anka {
 		
 		return key;
 	}
+
+	u64 GameState::CalculateMaterialKey() const
+	{
+		u64 key = C64(0);
+
+		for (Side color = WHITE; color <= BLACK; color++) {
+			for (PieceType t = PAWN; t < KING; t++) {
+				int count = bitboard::PopCount(m_piecesBB[t] & m_piecesBB[color]);
+				for (int i = 0; i < count; i++) {
+					key ^= zobrist_keys::piece_keys[color][t - 2][i];
+				}
+			}
+		}
+
+		return key;
+	}
+
+	u64 GameState::CalculatePawnKey() const
+	{
+		u64 key = C64(0);
+
+		for (Side color = WHITE; color <= BLACK; color++) {
+			Bitboard pawns = m_piecesBB[PAWN] & m_piecesBB[color];
+			while (pawns) {
+				Square sq = bitboard::BitScanForward(pawns);
+				key ^= zobrist_keys::piece_keys[color][PAWN - 2][sq];
+				pawns &= pawns - 1;
+			}
+		}
+
+		return key;
+	}
 }
\ No newline at end of file
@@ -4,38 +4,10 @@
 #include "tbprobe.h"
 #include <string.h>
 #include <iostream>
-#include <future>
 
 
 namespace {
 	constexpr size_t MAX_COMMAND_LENGTH = 4096;
-	long long AllocateTime(const anka::GameState& pos, int wtime, int winc, int btime, int binc, int movestogo)
-	{
-		using namespace anka;
-		long long available_time = 0;
-		long long increment = 0;
-		if (pos.SideToPlay() == WHITE) {
-			available_time = wtime;
-			increment = winc;
-		}
-		else {
-			available_time = btime;
-			increment = binc;
-		}
-
-		if (movestogo == 1) {
-			return ((available_time * 3) / 4) - EngineSettings::MOVE_OVERHEAD;
-		}
-		else if (movestogo <= 0) {
-			movestogo = 30;
-		}
-
-		available_time += (movestogo / 2) * increment;
-		available_time = available_time / movestogo;	
-		available_time -= EngineSettings::MOVE_OVERHEAD;
-
-		return available_time;
-	}
 }
 namespace anka {
 	void uci::UciLoop()
@@ -49,48 +21,65 @@ namespace anka {
 		root_pos.LoadStartPosition();
 
 
+		SearchThread search_thread;
+		if (!search_thread.Init()) {
+			return;
+		}
+
+		SearchLog search_log;
 		char* buffer = new char[MAX_COMMAND_LENGTH];
+		char* position_command = new char[MAX_COMMAND_LENGTH];
+		strcpy(position_command, "startpos");
 
-		std::future<void> future;
 		while (true) {
 			fgets(buffer, MAX_COMMAND_LENGTH, stdin);
 			char* line = buffer;
 
 			if (strncmp(line, "stop", 4) == 0) {
-				search_params.uci_stop_flag = true;
-				if (future.valid())
-					future.get();
+				search_params.Stop();
+				search_thread.Wait();
 			}
 			else if (strncmp(line, "quit", 4) == 0) {
-				search_params.uci_stop_flag = true;
-				if (future.valid())
-					future.get();
+				search_params.Stop();
+				search_thread.Wait();
 				break;
 			}
 
 			if (search_params.is_searching) {
 				if (strncmp(line, "isready", 7) == 0) {
 					if (search_params.uci_stop_flag) {
-						future.get(); // wrap up the last search
+						search_thread.Wait(); // wrap up the last search
 					}
 					OnIsReady();
 				}
+				else if (strncmp(line, "ponderhit", 9) == 0) {
+					PonderHit(search_params);
+				}
 				else {
 					fprintf(stderr, "Received command while searching: %s\n", line);
 				}
 			}
 			else {
+				// the search is marked as finished before bestmove is sent. it may still be saving its log
+				search_thread.Wait();
+
 				if (strncmp(line, "isready", 7) == 0) {
 					OnIsReady();
 				}
 				else if (strncmp(line, "go", 2) == 0) {
 					line += 2;
-					OnGo(root_pos, line, search_params);
+					OnGo(root_pos, line, options, search_params);
+					if (!options.search_log_path.empty()
+						&& search_log.BeginRecord(options.search_log_path.c_str(), position_command, line, options))
+					{
+						search_params.log = &search_log;
+					}
 					search_params.is_searching = true;
-					future = std::async(std::launch::async, StartSearch, std::ref(root_pos), std::ref(search_params));
+					search_thread.Go(root_pos, search_params);
 				}
 				else if (strncmp(line, "position ", 9) == 0) {
 					line += 9;
+					strcpy(position_command, line); // OnPosition modifies the line
 					OnPosition(root_pos, line);
 				}
 				else if (strncmp(line, "ucinewgame", 10) == 0) {
@@ -102,6 +91,10 @@ namespace anka {
 				else if (strncmp(line, "setoption ", 10) == 0) {
 					line += 10;
 					OnSetOption(options, line);
+					if (options.num_threads != search_thread.NumThreads() && !search_thread.SetNumThreads(options.num_threads)) {
+						fprintf(stderr, "AnkaError(MainLoop): Failed to start search threads\n");
+						options.num_threads = search_thread.NumThreads();
+					}
 				}
 				else if (strncmp(line, "anka_print", 10) == 0) {
 					OnPrint(root_pos);
@@ -110,13 +103,46 @@ namespace anka {
 					line += 11;
 					OnPerft(root_pos, line);
 				}
+				else if (strncmp(line, "anka_evalfile ", 14) == 0) {
+					line += 14;
+					OnEvalFile(line);
+				}
+				else if (strncmp(line, "anka_pawncheck ", 15) == 0) {
+					line += 15;
+					OnPawnCheck(line);
+				}
+				else if (strncmp(line, "anka_evalbench", 14) == 0) {
+					line += 14;
+					OnEvalBench(line);
+				}
 				else if (strncmp(line, "anka_eval", 9) == 0) {
 					OnEval(root_pos);
 				}
+				else if (strncmp(line, "anka_mate ", 10) == 0) {
+					line += 10;
+					OnMate(root_pos, line);
+				}
+				else if (strncmp(line, "anka_bench", 10) == 0) {
+					line += 10;
+					OnBench(search_thread, line);
+				}
+				else if (strncmp(line, "anka_replay ", 12) == 0) {
+					line += 12;
+					OnReplay(search_thread, options, line);
+				}
+				else if (strncmp(line, "anka_sliderbench", 16) == 0) {
+					line += 16;
+					OnSliderBench(line);
+				}
+				else if (strncmp(line, "anka_stoplatency", 16) == 0) {
+					line += 16;
+					OnStopLatency(search_thread, line);
+				}
 			}
 		}
 
 		delete[] buffer;
+		delete[] position_command;
 	}
 
 	void uci::OnUci()
@@ -127,6 +153,26 @@ namespace anka {
 			EngineSettings::DEFAULT_HASH_SIZE,
 			EngineSettings::MIN_HASH_SIZE,
 			EngineSettings::MAX_HASH_SIZE);
+		printf("option name Move Overhead type spin default %d min %d max %d\n",
+			EngineSettings::DEFAULT_MOVE_OVERHEAD,
+			EngineSettings::MIN_MOVE_OVERHEAD,
+			EngineSettings::MAX_MOVE_OVERHEAD);
+		printf("option name Ponder type check default false\n");
+		printf("option name MultiPV type spin default %d min %d max %d\n",
+			EngineSettings::DEFAULT_MULTI_PV,
+			EngineSettings::MIN_MULTI_PV,
+			EngineSettings::MAX_MULTI_PV);
+		printf("option name Threads type spin default %d min %d max %d\n",
+			EngineSettings::DEFAULT_THREADS,
+			EngineSettings::MIN_THREADS,
+			EngineSettings::MAX_THREADS);
+		printf("option name ParallelMode type combo default Lazy var Lazy var ABDADA\n");
+		printf("option name SearchLog type string default <empty>\n");
+		printf("option name EvalFile type string default <empty>\n");
+		printf("option name LazyEvalMargin type spin default %d min %d max %d\n",
+			EngineSettings::DEFAULT_LAZY_EVAL_MARGIN,
+			EngineSettings::MIN_LAZY_EVAL_MARGIN,
+			EngineSettings::MAX_LAZY_EVAL_MARGIN);
 		printf("option name SyzygyPath type string default null\n");
 		printf("uciok\n");
 	}
@@ -154,6 +200,67 @@ namespace anka {
 			}
 		}
 
+		// setoption name Move Overhead value 100
+		if (strncmp(line, "Move Overhead value ", 20) == 0) {
+			line += 20;
+			int overhead = atoi(line);
+			options.move_overhead = Clamp(overhead, EngineSettings::MIN_MOVE_OVERHEAD, EngineSettings::MAX_MOVE_OVERHEAD);
+		}
+
+		// setoption name MultiPV value 3
+		if (strncmp(line, "MultiPV value ", 14) == 0) {
+			line += 14;
+			int num_lines = atoi(line);
+			options.multi_pv = Clamp(num_lines, EngineSettings::MIN_MULTI_PV, EngineSettings::MAX_MULTI_PV);
+		}
+
+		// setoption name Threads value 4
+		if (strncmp(line, "Threads value ", 14) == 0) {
+			line += 14;
+			int num_threads = atoi(line);
+			options.num_threads = Clamp(num_threads, EngineSettings::MIN_THREADS, EngineSettings::MAX_THREADS);
+		}
+
+		// setoption name ParallelMode value ABDADA
+		if (strncmp(line, "ParallelMode value ", 19) == 0) {
+			line += 19;
+			if (strncmp(line, "Lazy", 4) == 0)
+				options.parallel_mode = ParallelMode::LAZY;
+			else if (strncmp(line, "ABDADA", 6) == 0)
+				options.parallel_mode = ParallelMode::ABDADA;
+		}
+
+		// setoption name SearchLog value logs/search
+		if (strncmp(line, "SearchLog value", 15) == 0) {
+			line += 15;
+			line += strspn(line, " ");
+			line[strcspn(line, "\r\n")] = '\0';
+			options.search_log_path = (strcmp(line, "<empty>") == 0) ? "" : line;
+		}
+
+		// setoption name EvalFile value nets/anka.nnue
+		if (strncmp(line, "EvalFile value", 14) == 0) {
+			line += 14;
+			line += strspn(line, " ");
+			line[strcspn(line, "\r\n")] = '\0';
+			if (*line == '\0' || strcmp(line, "<empty>") == 0) {
+				options.eval_file.clear();
+				nnue::UnloadNetwork();
+			}
+			else if (nnue::LoadNetwork(line)) {
+				options.eval_file = line;
+				printf("info string NNUE network %s loaded (%s)\n", line, nnue::SimdName());
+			}
+		}
+
+		// setoption name LazyEvalMargin value 300
+		if (strncmp(line, "LazyEvalMargin value ", 21) == 0) {
+			line += 21;
+			int margin = atoi(line);
+			options.lazy_eval_margin = Clamp(margin, EngineSettings::MIN_LAZY_EVAL_MARGIN, EngineSettings::MAX_LAZY_EVAL_MARGIN);
+			g_lazy_eval_margin = options.lazy_eval_margin;
+		}
+
 		// setoption name SyzygyPath value /tb
 		if (strncmp(line, "SyzygyPath value ", 17) == 0) {
 			line += 17;
@@ -201,20 +308,29 @@ namespace anka {
 		}
 	}
 
-	void uci::OnGo(const GameState& root_pos, char* line, SearchParams& params)
+	void uci::OnGo(const GameState& root_pos, char* line, const EngineSettings& options, SearchParams& params)
 	{
 		params.Clear();
-		params.start_time = Timer::GetTimeInMs();
-		int movestogo = 0;
+		params.go_time = Timer::GetTimeInUs();
+		params.multi_pv = options.multi_pv;
+		params.num_threads = options.num_threads;
+		params.parallel_mode = options.parallel_mode;
+		long long start_time = params.go_time / 1000;
+
+		// the clock doesn't run until ponderhit, but the time limits are calculated with the given clock
+		if (strstr(line, "ponder"))
+			params.ponder = true;
+		TimeControl tc;
 		int wtime = 0;
 		int btime = 0;
 		int winc = 0;
 		int binc = 0;
+		bool has_clock = false; // a clock token was given, even if its value is 0 or negative
 
+		// limits can be combined, the search stops at whichever is reached first
 		const char* pch = strstr(line, "infinite");
 		if (pch) {
 			params.infinite = true;
-			return;
 		}
 
 		pch = strstr(line, "depth ");
@@ -223,17 +339,31 @@ namespace anka {
 			int val = atoi(pch);
 			if (val > 0)
 				params.depth_limit = val;
-			return;
 		}
 
-		params.check_timeup = true;
+		pch = strstr(line, "mate ");
+		if (pch) {
+			pch += 5;
+			int val = atoi(pch);
+			if (val > 0)
+				params.mate_limit = val;
+		}
+
+		pch = strstr(line, "nodes ");
+		if (pch) {
+			pch += 6;
+			long long val = atoll(pch);
+			if (val > 0)
+				params.node_limit = static_cast<u64>(val);
+		}
+
 		pch = strstr(line, "movetime ");
 		if (pch) {
+			has_clock = true;
 			pch += 9;
 			int val = atoi(pch);
 			if (val > 0)
-				params.remaining_time = val;
-			return;
+				tc.movetime = val;
 		}
 
 		pch = strstr(line, "movestogo ");
@@ -241,11 +371,12 @@ namespace anka {
 			pch += 10;
 			int val = atoi(pch);
 			if (val > 0)
-				movestogo = val;
+				tc.movestogo = val;
 		}
 
 		pch = strstr(line, "wtime ");
 		if (pch) {
+			has_clock = true;
 			pch += 6;
 			int val = atoi(pch);
 			if (val > 0)
@@ -254,6 +385,7 @@ namespace anka {
 
 		pch = strstr(line, "btime ");
 		if (pch) {
+			has_clock = true;
 			pch += 6;
 			int val = atoi(pch);
 			if (val > 0)
@@ -276,7 +408,35 @@ namespace anka {
 				binc = val;
 		}
 
-		params.remaining_time = AllocateTime(root_pos, wtime, winc, btime, binc, movestogo);
+		// ex: searchmoves e2e4 d2d4 wtime 1000 ...
+		pch = strstr(line, "searchmoves ");
+		if (pch) {
+			pch += 12;
+			char move_str[6];
+			while (params.num_search_moves < kMoveListMaxSize) {
+				pch += strspn(pch, " ");
+				size_t token_length = strcspn(pch, " \n");
+				if (token_length == 0 || token_length > 5)
+					break;
+
+				strncpy(move_str, pch, token_length);
+				move_str[token_length] = '\0';
+				Move move = root_pos.ParseMove(move_str);
+				if (move == move::NO_MOVE)
+					break;
+
+				params.search_moves[params.num_search_moves++] = move;
+				pch += token_length;
+			}
+		}
+
+		tc.time_left = (root_pos.SideToPlay() == WHITE) ? wtime : btime;
+		tc.increment = (root_pos.SideToPlay() == WHITE) ? winc : binc;
+		// an empty clock still limits the search, TimeManager::Init gives it the minimum time
+		if (!params.infinite && has_clock) {
+			params.check_timeup = true;
+			params.time_manager.Init(tc, options.move_overhead, start_time);
+		}
 	}
 
 
@@ -301,6 +461,121 @@ namespace anka {
 	{
 		int eval_score = pos.ClassicalEvaluation();
 		printf("Static eval: %+.2f (%+d cp)\n", eval_score / 100.0f, eval_score);
+		if (nnue::NetworkLoaded()) {
+			eval_score = pos.NnueEvaluation();
+			printf("NNUE eval: %+.2f (%+d cp)\n", eval_score / 100.0f, eval_score);
+		}
+	}
+
+	void uci::OnMate(GameState& pos, char* line)
+	{
+		int max_moves = atoi(line);
+
+		if (max_moves <= 0 || max_moves > MAX_MATE_MOVES) {
+			printf("AnkaError(MainLoop): Invalid mate depth\n");
+			return;
+		}
+
+		SearchParams params;
+		MateResult result = SolveMate(pos, max_moves, params);
+		if (result.found) {
+			result.Print();
+		}
+		else {
+			printf("No mate in %d found\n", max_moves);
+		}
+		printf("Nodes: %" PRIu64 ", time: %lld ms\n", result.nodes, result.time);
+	}
+
+	void uci::OnBench(SearchThread& thread, char* line)
+	{
+		constexpr int DEFAULT_DEPTH = 12;
+		int depth = atoi(line);
+		if (depth <= 0 || depth > MAX_DEPTH)
+			depth = DEFAULT_DEPTH;
+
+		RunParallelBench(thread, depth);
+	}
+
+	void uci::OnReplay(SearchThread& thread, const EngineSettings& options, char* line)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		SearchLog log;
+		if (!log.Load(line))
+			return;
+
+		char command[MAX_COMMAND_LENGTH];
+		GameState pos;
+		snprintf(command, sizeof(command), "%s", log.PositionCommand());
+		OnPosition(pos, command);
+
+		// same thread and line counts as the recording. the clock isn't used, its decisions are in the log.
+		EngineSettings replay_options = options;
+		replay_options.num_threads = log.NumThreads();
+		replay_options.parallel_mode = log.GetParallelMode();
+		replay_options.multi_pv = log.MultiPV();
+
+		SearchParams params;
+		snprintf(command, sizeof(command), "%s", log.GoCommand());
+		OnGo(pos, command, replay_options, params);
+		params.infinite = false;
+		params.ponder = false;
+		params.check_timeup = false;
+
+		if (!thread.SetNumThreads(log.NumThreads()) || !log.BeginReplay()) {
+			thread.SetNumThreads(options.num_threads);
+			return;
+		}
+
+		params.log = &log;
+		params.is_searching = true;
+		thread.Go(pos, params);
+		thread.Wait();
+		thread.SetNumThreads(options.num_threads);
+
+		printf("Replay %s the recording\n", log.ReplayMatches() ? "matches" : "DOES NOT match");
+	}
+
+	void uci::OnStopLatency(SearchThread& thread, char* line)
+	{
+		constexpr int DEFAULT_MOVETIME = 1000;
+		int movetime = atoi(line);
+		if (movetime <= 0)
+			movetime = DEFAULT_MOVETIME;
+
+		RunStopLatencyBench(thread, movetime);
+	}
+
+	void uci::OnSliderBench(char* line)
+	{
+		constexpr int DEFAULT_ITERATIONS = 1000000;
+		int iterations = atoi(line);
+		if (iterations <= 0)
+			iterations = DEFAULT_ITERATIONS;
+
+		RunSliderBench(iterations);
+	}
+
+	void uci::OnEvalBench(char* line)
+	{
+		constexpr int DEFAULT_ITERATIONS = 10000;
+		int iterations = atoi(line);
+		if (iterations <= 0)
+			iterations = DEFAULT_ITERATIONS;
+
+		RunEvalBench(iterations);
+	}
+
+	void uci::OnEvalFile(char* line)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		RunPackedEvalBench(line);
+	}
+
+	void uci::OnPawnCheck(char* line)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		RunPawnSetCheck(line);
 	}
 
 }
@@ -2,12 +2,15 @@
 #include "core.hpp"
 #include "gamestate.hpp"
 #include "tests/perft.hpp"
+#include "tests/bench.hpp"
 #include "movegen.hpp"
 #include "engine_settings.hpp"
 #include "evaluation.hpp"
 #include "search.hpp"
+#include "searchthread.hpp"
+#include "mate.hpp"
+#include "searchlog.hpp"
 #include "ttable.hpp"
-#include <future>
 #include <string.h>
 
 
@@ -18,10 +21,18 @@ namespace anka {
 		void OnIsReady();
 		void OnSetOption(EngineSettings& options, char* line);
 		void OnPosition(GameState& pos, char* line);
-		void OnGo(const GameState& root_pos, char* line, SearchParams& params);
+		void OnGo(const GameState& root_pos, char* line, const EngineSettings& options, SearchParams& params);
 		void OnPrint(GameState& pos);
 		void OnPerft(GameState& pos, char* line);
 		void OnEval(GameState& pos);
+		void OnMate(GameState& pos, char* line);
+		void OnBench(SearchThread& thread, char* line);
+		void OnReplay(SearchThread& thread, const EngineSettings& options, char* line);
+		void OnStopLatency(SearchThread& thread, char* line);
+		void OnSliderBench(char* line);
+		void OnEvalBench(char* line);
+		void OnEvalFile(char* line);
+		void OnPawnCheck(char* line);
 	}
 
 
@@ -1,4 +1,5 @@
 #include "gamestate.hpp"
+#include "evaluation.hpp"
 #include "move.hpp"
 #include <assert.h>
 
@@ -17,6 +18,18 @@ static byte CastleRightsLUT[64]{
 
 namespace anka {
 
+	force_inline void GameState::AddPiecePSQT(PieceType piece_type, Side piece_color, Square sq)
+	{
+		m_psqt += g_eval_params.PST[piece_color][piece_type][sq];
+		m_phase_material += p_phase[piece_type];
+	}
+
+	force_inline void GameState::RemovePiecePSQT(PieceType piece_type, Side piece_color, Square sq)
+	{
+		m_psqt -= g_eval_params.PST[piece_color][piece_type][sq];
+		m_phase_material -= p_phase[piece_type];
+	}
+
 	void GameState::MakeMove(Move move)
 	{
 		Side opposite_side = m_side ^ 1;
@@ -27,6 +40,12 @@ namespace anka {
 		m_state_history[m_ply].ep_target = m_ep_target;
 		m_state_history[m_ply].half_move_clock = m_halfmove_clock;
 		m_state_history[m_ply].move_made = move;
+		m_state_history[m_ply].psqt = m_psqt;
+		m_state_history[m_ply].phase_material = m_phase_material;
+		m_state_history[m_ply].pawn_key = m_pawn_key;
+		m_state_history[m_ply].material_key = m_material_key;
+		nnue::DirtyPieces& dirty_pieces = m_state_history[m_ply].dirty_pieces;
+		dirty_pieces.num = 0;
 		m_key_history[m_root_ply_index + m_ply] = m_zobrist_key;
 
 		// remove hashes from key
@@ -49,20 +68,26 @@ namespace anka {
 
 		// remove moving_piece hash from key
 		UpdateKeyWithPiece(moving_piece, m_side, from);
+		RemovePiecePSQT(moving_piece, m_side, from);
 		m_piecesBB[moving_piece] ^= fromto_bb;
 		m_board[to] = moving_piece;
 		// add moving_piece 'to' hash
 		UpdateKeyWithPiece(moving_piece, m_side, to);
+		AddPiecePSQT(moving_piece, m_side, to);
+		dirty_pieces.Add(moving_piece, m_side, from, to);
 
 
 		if (moving_piece == PAWN) {
 			m_halfmove_clock = 0;
+			m_pawn_key ^= zobrist_keys::piece_keys[m_side][PAWN - 2][from];
+			m_pawn_key ^= zobrist_keys::piece_keys[m_side][PAWN - 2][to];
 			if (move::IsDoublePawnPush(move)) {
 				m_ep_target = to - push_dir;
 			}
 			else if (move::IsPromotion(move)) {
 				// undo moving_piece target sq hash
-				UpdateKeyWithPiece(moving_piece, m_side, to);
+				UpdateKeysWithPawn(m_side, to);
+				RemovePiecePSQT(moving_piece, m_side, to);
 				// undo moving_piece target sq bit
 				m_piecesBB[moving_piece] ^= to_bb;
 
@@ -72,6 +97,9 @@ namespace anka {
 				m_board[to] = promoted_piece;
 				// add promoted_piece hash
 				UpdateKeyWithPiece(promoted_piece, m_side, to);
+				AddPiecePSQT(promoted_piece, m_side, to);
+				dirty_pieces.to[0] = NO_SQUARE;
+				dirty_pieces.Add(promoted_piece, m_side, NO_SQUARE, to);
 			}
 		}
 
@@ -85,15 +113,24 @@ namespace anka {
 				m_piecesBB[opposite_side] ^= cap_piece_bb;
 				m_piecesBB[PAWN] ^= cap_piece_bb;
 				m_board[cap_piece_sq] = NO_PIECE;
+				UpdateMaterialKey(PAWN, opposite_side, bitboard::PopCount(m_piecesBB[PAWN] & m_piecesBB[opposite_side]));
 				// remove captured pawn hash
-				UpdateKeyWithPiece(PAWN, opposite_side, cap_piece_sq);
+				UpdateKeysWithPawn(opposite_side, cap_piece_sq);
+				RemovePiecePSQT(PAWN, opposite_side, cap_piece_sq);
+				dirty_pieces.Add(PAWN, opposite_side, cap_piece_sq, NO_SQUARE);
 			}
 			else {
 				PieceType captured_piece = move::CapturedPiece(move);
 				m_piecesBB[opposite_side] ^= to_bb;
 				m_piecesBB[captured_piece] ^= to_bb;
+				UpdateMaterialKey(captured_piece, opposite_side, bitboard::PopCount(m_piecesBB[captured_piece] & m_piecesBB[opposite_side]));
 				// remove captured piece hash
-				UpdateKeyWithPiece(captured_piece, opposite_side, to);
+				if (captured_piece == PAWN)
+					UpdateKeysWithPawn(opposite_side, to);
+				else
+					UpdateKeyWithPiece(captured_piece, opposite_side, to);
+				RemovePiecePSQT(captured_piece, opposite_side, to);
+				dirty_pieces.Add(captured_piece, opposite_side, to, NO_SQUARE);
 			}
 		}
 		else if (move::IsCastle(move)) {
@@ -118,6 +155,16 @@ namespace anka {
 
 			UpdateKeyWithPiece(ROOK, m_side, rook_from);
 			UpdateKeyWithPiece(ROOK, m_side, rook_to);
+			RemovePiecePSQT(ROOK, m_side, rook_from);
+			AddPiecePSQT(ROOK, m_side, rook_to);
+			dirty_pieces.Add(ROOK, m_side, rook_from, rook_to);
+		}
+
+		if (move::IsPromotion(move)) {
+			// counted after the capture: the promoted piece bit is toggled off while a captured piece of the same type is still on 'to'
+			PieceType promoted_piece = move::PromotedPiece(move);
+			UpdateMaterialKey(PAWN, m_side, bitboard::PopCount(m_piecesBB[PAWN] & m_piecesBB[m_side]));
+			UpdateMaterialKey(promoted_piece, m_side, bitboard::PopCount(m_piecesBB[promoted_piece] & m_piecesBB[m_side]) - 1);
 		}
 
 		// update castle permissions
@@ -210,6 +257,10 @@ namespace anka {
 		}
 
 		m_zobrist_key = m_key_history[m_root_ply_index + m_ply];
+		m_psqt = m_state_history[m_ply].psqt;
+		m_phase_material = m_state_history[m_ply].phase_material;
+		m_pawn_key = m_state_history[m_ply].pawn_key;
+		m_material_key = m_state_history[m_ply].material_key;
 		m_occupation = m_piecesBB[WHITE] | m_piecesBB[BLACK];
 		ANKA_ASSERT(Validate());
 	}
@@ -220,6 +271,7 @@ namespace anka {
 		m_state_history[m_ply].ep_target = m_ep_target;
 		m_state_history[m_ply].half_move_clock = m_halfmove_clock;
 		m_state_history[m_ply].move_made = move::NULL_MOVE;
+		m_state_history[m_ply].dirty_pieces.num = 0;
 
 		UpdateKeyWithEnPassant();
 		m_ep_target = NO_SQUARE;
@@ -0,0 +1,239 @@
+#include "mate.hpp"
+#include "movegen.hpp"
+#include "search.hpp"
+#include "timer.hpp"
+#include "util.hpp"
+
+namespace anka {
+	namespace {
+		ProofTable proof_table;
+
+		force_inline u32 SaturatedAdd(u32 a, u32 b)
+		{
+			return Min(a + b, PN_INFINITE);
+		}
+
+		class MateSolver {
+		public:
+			MateSolver(Side attacker, const SearchParams& params) : m_attacker(attacker), m_params(params) {}
+
+			/* Expands the node until phi >= th_phi or delta >= th_delta.
+			* Children are initialized from the proof table once and then tracked locally,
+			* so an overwritten table entry can't make the parent loop forever.
+			*/
+			void MID(GameState& pos, int plies_left, u32 th_phi, u32 th_delta, u32& phi, u32& delta, Move* best_move = nullptr)
+			{
+				m_nodes++;
+				if (m_nodes >= m_node_limit || m_params.Stopped()) {
+					m_stopped = true;
+				}
+
+				bool attacker_to_move = pos.SideToPlay() == m_attacker;
+
+				// draws and running out of plies are a win for the defender
+				if (pos.IsDrawn()) {
+					SetResult(attacker_to_move, false, phi, delta);
+					return;
+				}
+
+				MoveList<256> list;
+				bool in_check = list.GenerateLegalMoves(pos);
+				u64 pos_key = pos.PositionKey();
+
+				if (list.length == 0) {
+					// mated or stalemate at attacker nodes, only checkmate is a proof at defender nodes
+					SetResult(attacker_to_move, !attacker_to_move && in_check, phi, delta);
+					proof_table.Put(pos_key, plies_left, phi, delta, 1);
+					return;
+				}
+
+				if (plies_left == 0) {
+					SetResult(attacker_to_move, false, phi, delta);
+					proof_table.Put(pos_key, plies_left, phi, delta, 1);
+					return;
+				}
+
+				u64 nodes_start = m_nodes;
+				u64 child_keys[kMoveListMaxSize];
+				u32 child_phi[kMoveListMaxSize];
+				u32 child_delta[kMoveListMaxSize];
+				for (int i = 0; i < list.length; i++) {
+					int work;
+					pos.MakeMove(list.moves[i].move);
+					child_keys[i] = pos.PositionKey();
+					pos.UndoMove();
+					proof_table.Get(child_keys[i], plies_left - 1, child_phi[i], child_delta[i], work);
+				}
+
+				int best_index = 0;
+				while (true) {
+					// phi(n) = min delta(child), delta(n) = sum phi(child)
+					u32 min_delta = PN_INFINITE;
+					u32 second_delta = PN_INFINITE;
+					u32 sum_phi = 0;
+					best_index = 0;
+					for (int i = 0; i < list.length; i++) {
+						sum_phi = SaturatedAdd(sum_phi, child_phi[i]);
+						if (child_delta[i] < min_delta) {
+							second_delta = min_delta;
+							min_delta = child_delta[i];
+							best_index = i;
+						}
+						else if (child_delta[i] < second_delta) {
+							second_delta = child_delta[i];
+						}
+					}
+
+					phi = min_delta;
+					delta = sum_phi;
+					if (phi >= th_phi || delta >= th_delta || m_stopped)
+						break;
+
+					u32 child_th_phi = Min<u64>(static_cast<u64>(th_delta) + child_phi[best_index] - delta, PN_INFINITE);
+					u32 child_th_delta = Min(th_phi, second_delta + 1);
+
+					pos.MakeMove(list.moves[best_index].move);
+					MID(pos, plies_left - 1, child_th_phi, child_th_delta, child_phi[best_index], child_delta[best_index]);
+					pos.UndoMove();
+				}
+
+				if (best_move)
+					*best_move = list.moves[best_index].move;
+
+				if (!m_stopped)
+					proof_table.Put(pos_key, plies_left, phi, delta, m_nodes - nodes_start);
+			}
+
+			// Follows proven children in the table. The defender plays the move that delays the mate the longest.
+			int ExtractPV(GameState& pos, Move root_move, int plies_left, Move* pv) const
+			{
+				pv[0] = root_move;
+				pos.MakeMove(root_move);
+				int moves_made = 1;
+				plies_left--;
+
+				while (plies_left > 0) {
+					MoveList<256> list;
+					list.GenerateLegalMoves(pos);
+					bool attacker_to_move = pos.SideToPlay() == m_attacker;
+
+					Move next_move = move::NO_MOVE;
+					int max_length = -1;
+					for (int i = 0; i < list.length; i++) {
+						pos.MakeMove(list.moves[i].move);
+						int length = ProofLength(pos.PositionKey(), plies_left - 1, attacker_to_move);
+						pos.UndoMove();
+
+						if (length >= 0 && (attacker_to_move ? (max_length < 0 || length < max_length) : length > max_length)) {
+							max_length = length;
+							next_move = list.moves[i].move;
+						}
+					}
+
+					if (next_move == move::NO_MOVE)
+						break;
+
+					pv[moves_made++] = next_move;
+					pos.MakeMove(next_move);
+					plies_left--;
+				}
+
+				for (int i = 0; i < moves_made; i++) {
+					pos.UndoMove();
+				}
+
+				return moves_made;
+			}
+
+			// Shortest proof of a child node in the table, in plies. -1 if it isn't proven within 'max_plies'.
+			// The child is a defender node if the attacker is to move at the parent.
+			int ProofLength(u64 child_key, int max_plies, bool defender_node) const
+			{
+				for (int plies = max_plies & 1; plies <= max_plies; plies += 2) {
+					u32 phi, delta;
+					int work;
+					// proven: delta == 0 at defender nodes, phi == 0 at attacker nodes
+					if (proof_table.Get(child_key, plies, phi, delta, work) && (defender_node ? delta == 0 : phi == 0))
+						return plies;
+				}
+
+				return -1;
+			}
+
+			void SetNodeLimit(u64 limit) { m_node_limit = limit; }
+			u64 Nodes() const { return m_nodes; }
+			bool Stopped() const { return m_stopped; }
+		private:
+			// phi/delta of a solved node, 'proven' is from the attacker's point of view
+			static force_inline void SetResult(bool attacker_to_move, bool proven, u32& phi, u32& delta)
+			{
+				bool mover_wins = (attacker_to_move == proven);
+				phi = mover_wins ? 0 : PN_INFINITE;
+				delta = mover_wins ? PN_INFINITE : 0;
+			}
+
+			Side m_attacker;
+			const SearchParams& m_params;
+			u64 m_nodes = 0;
+			u64 m_node_limit = UINT64_MAX;
+			bool m_stopped = false;
+		};
+	}
+
+	void MateResult::Print() const
+	{
+		char move_str[6];
+		u64 nps = static_cast<u64>(nodes / (time / 1000.0));
+
+		printf("info depth %d time %lld nodes %" PRIu64 " nps %" PRIu64 " score mate %d pv ",
+			2 * mate_in - 1, time, nodes, nps, mate_in);
+
+		for (int i = 0; i < pv_length; i++) {
+			move::ToString(pv[i], move_str);
+			printf("%s ", move_str);
+		}
+
+		putchar('\n');
+	}
+
+	MateResult SolveMate(GameState& pos, int max_moves, const SearchParams& params)
+	{
+		MateResult result;
+		if (!proof_table.Init(DEFAULT_PROOF_TABLE_SIZE)) {
+			fprintf(stderr, "AnkaError(Mate): Failed to allocate proof table\n");
+			result.stopped = true;
+			return result;
+		}
+		proof_table.Clear();
+
+		auto start_time = Timer::GetTimeInMs();
+		MateSolver solver(pos.SideToPlay(), params);
+		if (params.node_limit > 0)
+			solver.SetNodeLimit(params.node_limit);
+
+		// shortest mate first. a mate in n is at most 2n - 1 plies deep
+		max_moves = Clamp(max_moves, 1, MAX_MATE_MOVES);
+		for (int n = 1; n <= max_moves; n++) {
+			int plies = 2 * n - 1;
+			u32 phi, delta;
+			Move best_move = move::NO_MOVE;
+			solver.MID(pos, plies, PN_INFINITE, PN_INFINITE, phi, delta, &best_move);
+
+			if (solver.Stopped()) {
+				result.stopped = true;
+				break;
+			}
+
+			if (phi == 0) {
+				result.found = true;
+				result.mate_in = n;
+				result.pv_length = solver.ExtractPV(pos, best_move, plies, result.pv);
+				break;
+			}
+		}
+
+		result.nodes = solver.Nodes();
+		result.time = Max(Timer::GetTimeInMs() - start_time, 1LL);
+		return result;
+	}
+}
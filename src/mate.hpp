@@ -0,0 +1,158 @@
+#pragma once
+#include "core.hpp"
+#include "gamestate.hpp"
+#include "move.hpp"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace anka {
+	struct SearchParams;
+
+	inline constexpr u32 PN_INFINITE = 1u << 30;
+	inline constexpr int MAX_MATE_MOVES = 32;
+	inline constexpr int DEFAULT_PROOF_TABLE_SIZE = 16; // MiB
+
+	/* Proof and disproof numbers are stored in phi/delta form, from the side to move's perspective:
+	* phi is the proof number at attacker nodes and the disproof number at defender nodes.
+	* phi == 0 means the side to move reaches its goal (attacker: mate, defender: escape).
+	* Each record is 16 bytes
+	*/
+	struct PNRecord {
+		u32 key;
+		u32 phi;
+		u32 delta;
+		u16 work; // nodes searched below this node, saturated. used for replacement
+		byte plies_left;
+		byte unused;
+	};
+	static_assert(sizeof(PNRecord) == 16, "PNRecord: unexpected struct alignment");
+
+	/* Hash table for the df-pn mate solver. Separate from the main transposition table because
+	* the stored values aren't scores and a depth limited proof is only valid for the same
+	* number of remaining plies, which is part of the key.
+	*/
+	class ProofTable {
+	public:
+		ProofTable() = default;
+		~ProofTable()
+		{
+			free(m_table);
+		}
+		ProofTable(const ProofTable&) = delete;
+		ProofTable& operator=(const ProofTable&) = delete;
+
+		bool Init(size_t size_mb)
+		{
+			size_t table_size = 1 * MiB;
+			// round down to nearest power of two
+			while (size_mb >>= 1) {
+				table_size <<= 1;
+			}
+
+			if (table_size == m_table_size)
+				return true;
+
+			PNBucket* table = (PNBucket*)realloc(m_table, table_size);
+			if (table == nullptr)
+				return false;
+
+			m_table = table;
+			m_table_size = table_size;
+			m_num_buckets = table_size / sizeof(PNBucket);
+			Clear();
+			return true;
+		}
+
+		void Clear()
+		{
+			memset(m_table, 0, m_table_size);
+		}
+
+		// returns false and sets phi = delta = 1 for unknown nodes
+		bool Get(u64 pos_hash, int plies_left, u32& phi, u32& delta, int& work) const
+		{
+			u64 hash = Hash(pos_hash, plies_left);
+			const PNBucket& bucket = m_table[hash & (m_num_buckets - 1)];
+			u32 key = static_cast<u32>(hash >> 32);
+
+			for (int i = 0; i < num_cells; i++) {
+				const PNRecord& rec = bucket.records[i];
+				if (rec.key == key && rec.plies_left == plies_left && rec.phi + rec.delta > 0) {
+					phi = rec.phi;
+					delta = rec.delta;
+					work = rec.work;
+					return true;
+				}
+			}
+
+			phi = 1;
+			delta = 1;
+			work = 0;
+			return false;
+		}
+
+		void Put(u64 pos_hash, int plies_left, u32 phi, u32 delta, u64 work)
+		{
+			u64 hash = Hash(pos_hash, plies_left);
+			PNBucket& bucket = m_table[hash & (m_num_buckets - 1)];
+			u32 key = static_cast<u32>(hash >> 32);
+
+			// replacement strategy: same entry > least work
+			int chosen_index = 0;
+			for (int i = 0; i < num_cells; i++) {
+				const PNRecord& rec = bucket.records[i];
+				if (rec.key == key && rec.plies_left == plies_left) {
+					chosen_index = i;
+					break;
+				}
+				if (rec.work < bucket.records[chosen_index].work) {
+					chosen_index = i;
+				}
+			}
+
+			PNRecord& rec = bucket.records[chosen_index];
+			rec.key = key;
+			rec.phi = phi;
+			rec.delta = delta;
+			rec.work = static_cast<u16>(work < 0xFFFF ? work : 0xFFFF);
+			rec.plies_left = static_cast<byte>(plies_left);
+		}
+	private:
+		static constexpr int num_cells = 4;
+		static constexpr size_t MiB = 1'048'576;
+		struct PNBucket {
+			PNRecord records[num_cells];
+		};
+		static_assert(sizeof(PNBucket) == 64, "PNBucket: unexpected struct alignment");
+
+		static force_inline u64 Hash(u64 pos_hash, int plies_left)
+		{
+			return pos_hash ^ (static_cast<u64>(plies_left) * C64(0x9E3779B97F4A7C15));
+		}
+
+		PNBucket* m_table = nullptr;
+		size_t m_num_buckets = 0;
+		size_t m_table_size = 0;
+	};
+
+	struct MateResult {
+		bool found = false;
+		bool stopped = false; // the search was stopped before the position was solved
+		int mate_in = 0; // in moves
+		u64 nodes = 0;
+		long long time = 1; // ms
+		Move pv[2 * MAX_MATE_MOVES]{};
+		int pv_length = 0;
+
+		void Print() const;
+	};
+
+	/* Depth limited df-pn mate solver. Searches for a forced mate for the side to move in at most
+	* 'max_moves' moves (shortest first). Respects the stop flag and the node limit of 'params'.
+	* Unlike PVS there is no pruning or reduction, so a found mate is always sound and
+	* "no mate" means there is no mate within the limit (unless stopped).
+	* The proof table is allocated on the first call.
+	*/
+	MateResult SolveMate(GameState& pos, int max_moves, const SearchParams& params);
+}
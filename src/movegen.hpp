@@ -96,6 +96,19 @@ namespace anka {
 			return false;
 		}
 
+		// removes 'm' from the list. returns false if it isn't in the list
+		bool Remove(Move m)
+		{
+			for (int i = 0; i < length; i++) {
+				if (m == moves[i].move) {
+					moves[i] = moves[length - 1];
+					length--;
+					return true;
+				}
+			}
+			return false;
+		}
+
 		Move FindTBMove(Square from, Square to, PieceType prom) const
 		{
 			for (int i = 0; i < length; i++) {
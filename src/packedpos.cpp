@@ -0,0 +1,180 @@
+#include "packedpos.hpp"
+#include "gamestate.hpp"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef PLATFORM_WINDOWS
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace anka {
+	namespace {
+		constexpr char PACKED_MAGIC[8] = { 'A', 'N', 'K', 'A', 'P', 'O', 'S', '1' };
+
+		struct PackedFileHeader {
+			char magic[8];
+			u64 num_positions;
+			u64 unused[2];
+		};
+		static_assert(sizeof(PackedFileHeader) == sizeof(PackedPosition), "PackedFileHeader: the positions must stay aligned");
+	}
+
+	void PackPosition(const GameState& pos, int result, int score, PackedPosition& packed)
+	{
+		memset(&packed, 0, sizeof(packed));
+		packed.occupancy = pos.Occupancy();
+
+		Bitboard occupancy = packed.occupancy;
+		Bitboard black_pieces = pos.BlackPieces();
+		for (int i = 0; occupancy; i++) {
+			Square sq = bitboard::BitScanForward(occupancy);
+			int code = pos.GetPiece(sq) | (bitboard::BitIsSet(black_pieces, sq) ? 8 : 0);
+			packed.pieces[i / 2] |= static_cast<byte>(code << (4 * (i & 1)));
+			occupancy &= occupancy - 1;
+		}
+
+		packed.score = static_cast<i16>(score);
+		packed.flags = static_cast<byte>(pos.SideToPlay() | (result << 1));
+		packed.castling_rights = pos.CastlingRights();
+		packed.ep_target = static_cast<byte>(pos.EnPassantSquare());
+		packed.halfmove_clock = static_cast<byte>(Min(pos.HalfMoveClock(), 255));
+	}
+
+	bool PackedPositionWriter::Open(const char* path)
+	{
+		Close();
+		m_file = fopen(path, "wb");
+		if (!m_file) {
+			fprintf(stderr, "AnkaError(PackedPosition): Failed to open %s\n", path);
+			return false;
+		}
+
+		// the count is written by Close
+		PackedFileHeader header{};
+		memcpy(header.magic, PACKED_MAGIC, sizeof(PACKED_MAGIC));
+		m_num_positions = 0;
+		return fwrite(&header, sizeof(header), 1, m_file) == 1;
+	}
+
+	bool PackedPositionWriter::Write(const PackedPosition& packed)
+	{
+		if (fwrite(&packed, sizeof(packed), 1, m_file) != 1)
+			return false;
+
+		m_num_positions++;
+		return true;
+	}
+
+	bool PackedPositionWriter::Close()
+	{
+		if (!m_file)
+			return true;
+
+		bool ok = fseek(m_file, offsetof(PackedFileHeader, num_positions), SEEK_SET) == 0
+			&& fwrite(&m_num_positions, sizeof(m_num_positions), 1, m_file) == 1;
+		ok = fclose(m_file) == 0 && ok;
+		m_file = nullptr;
+		if (!ok)
+			fprintf(stderr, "AnkaError(PackedPosition): Failed to write the packed position file\n");
+		return ok;
+	}
+
+	bool PackedPositionFile::IsPackedFile(const char* path)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file)
+			return false;
+
+		char magic[sizeof(PACKED_MAGIC)];
+		bool is_packed = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, PACKED_MAGIC, sizeof(PACKED_MAGIC)) == 0;
+		fclose(file);
+		return is_packed;
+	}
+
+	bool PackedPositionFile::Open(const char* path)
+	{
+		Close();
+
+	#ifdef PLATFORM_WINDOWS
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		LARGE_INTEGER file_size;
+		if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size)) {
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			fprintf(stderr, "AnkaError(PackedPosition): Failed to open %s\n", path);
+			return false;
+		}
+		m_file_handle = file;
+		m_view_size = static_cast<size_t>(file_size.QuadPart);
+
+		if (m_view_size >= sizeof(PackedFileHeader)) {
+			m_mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_mapping_handle)
+				m_view = MapViewOfFile(m_mapping_handle, FILE_MAP_READ, 0, 0, 0);
+		}
+	#else
+		int fd = open(path, O_RDONLY);
+		struct stat file_stat;
+		if (fd < 0 || fstat(fd, &file_stat) != 0) {
+			if (fd >= 0)
+				close(fd);
+			fprintf(stderr, "AnkaError(PackedPosition): Failed to open %s\n", path);
+			return false;
+		}
+		m_view_size = static_cast<size_t>(file_stat.st_size);
+
+		if (m_view_size >= sizeof(PackedFileHeader)) {
+			void* view = mmap(nullptr, m_view_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (view != MAP_FAILED) {
+				m_view = view;
+				madvise(m_view, m_view_size, MADV_SEQUENTIAL);
+			}
+		}
+		close(fd); // the mapping keeps the file open
+	#endif
+
+		const PackedFileHeader* header = static_cast<const PackedFileHeader*>(m_view);
+		bool ok = header
+			&& memcmp(header->magic, PACKED_MAGIC, sizeof(PACKED_MAGIC)) == 0
+			&& header->num_positions == (m_view_size - sizeof(PackedFileHeader)) / sizeof(PackedPosition)
+			&& (m_view_size - sizeof(PackedFileHeader)) % sizeof(PackedPosition) == 0;
+
+		if (!ok) {
+			fprintf(stderr, "AnkaError(PackedPosition): %s is not a valid packed position file\n", path);
+			Close();
+			return false;
+		}
+
+		m_positions = reinterpret_cast<const PackedPosition*>(header + 1);
+		m_num_positions = static_cast<size_t>(header->num_positions);
+		return true;
+	}
+
+	void PackedPositionFile::Close()
+	{
+	#ifdef PLATFORM_WINDOWS
+		if (m_view)
+			UnmapViewOfFile(m_view);
+		if (m_mapping_handle)
+			CloseHandle(m_mapping_handle);
+		if (m_file_handle)
+			CloseHandle(m_file_handle);
+		m_mapping_handle = nullptr;
+		m_file_handle = nullptr;
+	#else
+		if (m_view)
+			munmap(m_view, m_view_size);
+	#endif
+		m_view = nullptr;
+		m_view_size = 0;
+		m_positions = nullptr;
+		m_num_positions = 0;
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "core.hpp"
+#include "boarddefs.hpp"
+#include "bitboard.hpp"
+#include <stdio.h>
+
+namespace anka {
+	class GameState;
+
+	/* A position with its game result in 32 bytes, for training and test sets. The pieces of the occupied
+	* squares are stored from A1 to H8, two per byte (low nibble first) as PieceType | (side << 3).
+	* The move history isn't stored, so repetitions before the position aren't known after unpacking.
+	*/
+	struct PackedPosition {
+		static constexpr i16 NO_SCORE = INT16_MIN;
+
+		Bitboard occupancy;
+		byte pieces[16];
+		i16 score; // white relative search score in centipawns, NO_SCORE if unknown
+		byte flags; // bit 0: side to move, bits 1-2: game result
+		byte castling_rights;
+		byte ep_target; // NO_SQUARE if there is none
+		byte halfmove_clock;
+		byte unused[2];
+
+		force_inline Side SideToPlay() const { return flags & 1; }
+		// 0 if black won, 1 for a draw, 2 if white won
+		force_inline int Result() const { return (flags >> 1) & 3; }
+	};
+	static_assert(sizeof(PackedPosition) == 32, "PackedPosition: unexpected struct alignment");
+
+	// 'result' is 0 if black won, 1 for a draw and 2 if white won. 'score' is white relative or NO_SCORE
+	void PackPosition(const GameState& pos, int result, int score, PackedPosition& packed);
+
+	/* File format: a 32 byte header (magic, position count) followed by the positions, in the byte order of
+	* the machine that wrote it (little endian on x86). Positions are appended one at a time, and Close
+	* writes the final count to the header.
+	*/
+	class PackedPositionWriter {
+	public:
+		PackedPositionWriter() = default;
+		PackedPositionWriter(const PackedPositionWriter&) = delete;
+		PackedPositionWriter& operator=(const PackedPositionWriter&) = delete;
+		~PackedPositionWriter() { Close(); }
+
+		bool Open(const char* path);
+		bool Write(const PackedPosition& packed);
+		bool Close();
+		u64 Size() const { return m_num_positions; }
+	private:
+		FILE* m_file = nullptr;
+		u64 m_num_positions = 0;
+	};
+
+	/* Read only memory mapping of a packed position file. Positions() points into the mapping, so the
+	* positions are read without copies and the OS pages them in as they are used.
+	*/
+	class PackedPositionFile {
+	public:
+		PackedPositionFile() = default;
+		PackedPositionFile(const PackedPositionFile&) = delete;
+		PackedPositionFile& operator=(const PackedPositionFile&) = delete;
+		~PackedPositionFile() { Close(); }
+
+		bool Open(const char* path);
+		void Close();
+
+		const PackedPosition* Positions() const { return m_positions; }
+		size_t Size() const { return m_num_positions; }
+
+		// Returns true if the file at 'path' starts with the packed position file magic
+		static bool IsPackedFile(const char* path);
+	private:
+		const PackedPosition* m_positions = nullptr;
+		size_t m_num_positions = 0;
+		void* m_view = nullptr;
+		size_t m_view_size = 0;
+		#ifdef PLATFORM_WINDOWS
+		void* m_file_handle = nullptr;
+		void* m_mapping_handle = nullptr;
+		#endif
+	};
+}
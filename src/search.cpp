@@ -1,19 +1,20 @@
 #include "search.hpp"
+#include "searchthread.hpp"
+#include "searchlog.hpp"
 #include "util.hpp"
 #include "evaluation.hpp"
+#include "mate.hpp"
 #include "tbprobe.h"
 
 namespace anka {
     namespace {
         constexpr int PV_NODE = 1;
         constexpr int NOT_PV= 0;
-        constexpr int nodes_per_time_check = 2047;
         constexpr int MAX_PV_LENGTH = MAX_DEPTH + 1;
 
         Move principal_variation[MAX_PV_LENGTH]{};
         int LMR[MAX_DEPTH+1][256]{};
-        KillersTable killers;
-        SearchStack* s_stack;
+        DeadlineTimer* s_deadline_timer;
 
         void InitLMR()
         {
@@ -25,74 +26,242 @@ namespace anka {
         }
 
         constexpr int TB_WIN_SCORE = 10000;
+
+        // ABDADA
+        constexpr int ABDADA_MIN_DEPTH = 3; // shallower moves are cheaper to search twice than to mark
+        constexpr int BUSY_TABLE_SIZE = 1 << 15;
+        constexpr int MAX_DEFERRED_MOVES = 32;
+
+        // (position, move) pairs that are being searched by some thread
+        std::atomic<u64> busy_table[BUSY_TABLE_SIZE];
+
+        force_inline u64 MoveHash(u64 pos_key, Move move)
+        {
+            return pos_key ^ (static_cast<u64>(move) * C64(0x9E3779B97F4A7C15));
+        }
+
+        force_inline bool IsBusy(u64 move_hash)
+        {
+            return busy_table[move_hash & (BUSY_TABLE_SIZE - 1)].load(std::memory_order_relaxed) == move_hash;
+        }
+
+        force_inline void SetBusy(u64 move_hash)
+        {
+            busy_table[move_hash & (BUSY_TABLE_SIZE - 1)].store(move_hash, std::memory_order_relaxed);
+        }
+
+        force_inline void ClearBusy(u64 move_hash)
+        {
+            // leave the entry alone if another thread has taken it over
+            u64 expected = move_hash;
+            busy_table[move_hash & (BUSY_TABLE_SIZE - 1)].compare_exchange_strong(expected, C64(0), std::memory_order_relaxed);
+        }
+
+        // go nodes limits the nodes of all threads. Each thread adds its nodes to the shared count at least
+        // every NODE_REPORT_INTERVAL nodes and at the end of each iteration. A single thread stops exactly at
+        // the limit, parallel searches may overshoot it by up to NODE_REPORT_INTERVAL nodes per thread.
+        constexpr u64 NODE_REPORT_INTERVAL = 1024;
+        u64 search_node_limit = 0; // 0: no limit
+        std::atomic<u64> search_nodes;
+
+        // Access to the state shared between threads goes through the thread's log when recording or replaying
+        force_inline bool IsStopped(const SearchParams& params, ThreadLog* log)
+        {
+            return log ? log->Stopped(params.Stopped()) : params.Stopped();
+        }
+
+        force_inline bool ProbeTT(ThreadLog* log, u64 pos_key, TTRecord& result, int ply)
+        {
+            return log ? log->Probe(pos_key, result, ply) : g_trans_table.Get(pos_key, result, ply);
+        }
+
+        force_inline void StoreTT(ThreadLog* log, u64 pos_key, NodeType type, int depth, Move best_move, i16 value, int ply, bool timeup)
+        {
+            if (log)
+                log->Store(pos_key, type, depth, best_move, value, ply, timeup);
+            else
+                g_trans_table.Put(pos_key, type, depth, best_move, value, ply, timeup);
+        }
+
+        force_inline bool IsMoveBusy(ThreadLog* log, u64 move_hash)
+        {
+            return log ? log->Busy(IsBusy(move_hash)) : IsBusy(move_hash);
+        }
+
+        // Shared with the helper threads, written by the main search thread before the helpers start
+        SearchParams helper_params; // the stop flag and the parallel mode are used
+        SearchLog* helper_log = nullptr;
+        int helper_max_depth = MAX_DEPTH;
+        const Move* helper_excluded_moves = nullptr;
+        int helper_num_excluded = 0;
+        std::atomic<u64> helper_nodes[EngineSettings::MAX_THREADS];
+
+        // Iterative deepening on a helper thread. Results are shared only through the transposition table.
+        void HelperSearch(int helper_id, GameState& pos, SearchStack& stack)
+        {
+            stack.killers.Clear();
+            helper_nodes[helper_id].store(0, std::memory_order_relaxed);
+
+            // lazy: half of the helpers search one ply deeper than the main thread
+            bool lazy = helper_params.parallel_mode == ParallelMode::LAZY;
+            ThreadLog* log = helper_log ? helper_log->Thread(helper_id + 1) : nullptr;
+            int start_depth = (lazy && (helper_id & 1) == 0) ? 3 : 2;
+            u64 nodes = 0;
+            for (int d = start_depth; d <= helper_max_depth; d++) {
+                SearchInstance instance(&stack);
+                instance.excluded_root_moves = helper_excluded_moves;
+                instance.num_excluded_root_moves = helper_num_excluded;
+                instance.abdada = !lazy;
+                instance.log = log;
+                instance.ReportNodes(helper_params);
+                instance.PVS<PV_NODE, true>(pos, -ANKA_INFINITE, ANKA_INFINITE, d, helper_params);
+                instance.ReportNodes(helper_params);
+
+                nodes += instance.nodes_visited;
+                helper_nodes[helper_id].store(nodes, std::memory_order_relaxed);
+                if (IsStopped(helper_params, log))
+                    break;
+            }
+        }
+
+        // The search is marked as finished before bestmove is sent. A GUI may send the next
+        // position and go right after bestmove, and the UCI loop rejects commands while searching.
+        void SendBestMove(SearchParams& params, Move best_move, Move ponder_move = move::NO_MOVE)
+        {
+            char best_move_str[6];
+            move::ToString(best_move, best_move_str);
+            params.is_searching = false;
+            if (ponder_move != move::NO_MOVE) {
+                char ponder_move_str[6];
+                move::ToString(ponder_move, ponder_move_str);
+                printf("bestmove %s ponder %s\n", best_move_str, ponder_move_str);
+            }
+            else {
+                printf("bestmove %s\n", best_move_str);
+            }
+        }
+
+        // nodes of the completed helper iterations
+        u64 HelperNodes(int num_helpers)
+        {
+            u64 nodes = 0;
+            for (int i = 0; i < num_helpers; i++) {
+                nodes += helper_nodes[i].load(std::memory_order_relaxed);
+            }
+            return nodes;
+        }
     }
 
     bool InitSearch()
     {
         InitLMR();
-        s_stack = (SearchStack*)malloc(sizeof(SearchStack));
-        if (!s_stack) {
-            fprintf(stderr, "Failed to allocate search stack memory\n");
-            return false;
-        }
+        s_deadline_timer = new DeadlineTimer();
         return true;
     }
 
-    void FreeSearchStack()
+    void FreeSearch()
     {
-        free(s_stack);
+        delete s_deadline_timer;
     }
 
 
-
-    void SearchInstance::CheckTime(SearchParams& params)
+    void PonderHit(SearchParams& params)
     {
-        auto curr_time = Timer::GetTimeInMs();
-        auto time_passed = curr_time - last_timecheck;
-        last_timecheck = curr_time;
-
-        params.remaining_time-= time_passed;
+        if (!params.ponder)
+            return;
 
-            if (params.remaining_time <= 0)
-                params.uci_stop_flag = true;
+        // the opponent played the expected move, our clock starts now
+        if (params.check_timeup) {
+            auto& tm = params.time_manager;
+            tm.SetStartTime(Timer::GetTimeInMs());
+            s_deadline_timer->Arm(tm.StartTime() + tm.MaximumTime(), &params.uci_stop_flag);
+        }
+        params.StopPondering();
     }
 
-    void StartSearch(GameState& pos, SearchParams& params)
+    void StartSearch(GameState& pos, SearchParams& params, SearchStack& stack, HelperPool& helpers)
     {
-        killers.Clear();
+        SearchLog* search_log = (params.log && params.log->Mode() != LogMode::OFF) ? params.log : nullptr;
+        ThreadLog* main_log = search_log ? search_log->Thread(0) : nullptr;
+        bool replaying = search_log && search_log->Mode() == LogMode::REPLAY;
+
+        // a replay reads the transposition table results from the log, the PV comes from the main thread's private table
+        TranspositionTable& pv_table = replaying ? main_log->PrivateTable() : g_trans_table;
+
+        stack.killers.Clear();
         for (int i = 0; i < MAX_PV_LENGTH; i++) {
             principal_variation[i] = move::NO_MOVE;
         }
         g_trans_table.IncrementAge();
+        if (params.check_timeup && !params.ponder) {
+            auto& tm = params.time_manager;
+            s_deadline_timer->Arm(tm.StartTime() + tm.MaximumTime(), &params.uci_stop_flag);
+        }
 
         char best_move_str[6];
-        Move best_move = move::NO_MOVE;       
+        Move best_move = move::NO_MOVE;
+        Move ponder_move = move::NO_MOVE;
         MoveList<256> root_moves;
         bool in_check = root_moves.GenerateLegalMoves(pos);
 
+        // Moves excluded at the root. Starts with the moves not listed in "go searchmoves",
+        // MultiPV appends the best moves of the lines found so far.
+        Move excluded_moves[kMoveListMaxSize + EngineSettings::MAX_MULTI_PV]{};
+        int num_base_excluded = 0;
+        if (params.num_search_moves > 0) {
+            MoveList<256> filtered_moves;
+            for (int i = 0; i < root_moves.length; i++) {
+                Move m = root_moves.moves[i].move;
+                bool is_search_move = false;
+                for (int j = 0; j < params.num_search_moves; j++) {
+                    is_search_move |= (params.search_moves[j] == m);
+                }
+
+                if (is_search_move)
+                    filtered_moves.moves[filtered_moves.length++] = root_moves.moves[i];
+                else
+                    excluded_moves[num_base_excluded++] = root_moves.moves[i].move;
+            }
+
+            // none of the given moves are legal, search all moves instead
+            if (filtered_moves.length > 0)
+                root_moves = filtered_moves;
+            else
+                num_base_excluded = 0;
+        }
+
         if (root_moves.length == 0) {
             if (in_check)
                 printf("info depth 0 score mate 0\n");
             else
                 printf("info depth 0 score cp 0\n");
 
-            while (params.infinite && !params.uci_stop_flag);
-            printf("bestmove 0000\n");
-            params.is_searching = false;
+            params.WaitForStop();
+            s_deadline_timer->Disarm();
+            SendBestMove(params, move::NO_MOVE);
             return;
         }
         else {
-            SearchInstance instance;
+            SearchInstance instance(&stack);
+            instance.excluded_root_moves = excluded_moves;
+            instance.num_excluded_root_moves = num_base_excluded;
+            instance.log = main_log;
             SearchParams temp_params;
             int score = instance.PVS<PV_NODE, true>(pos, -ANKA_INFINITE, ANKA_INFINITE, 1, temp_params);
             best_move = instance.root_best_move;
 
             move::ToString(best_move, best_move_str);
             printf("info depth 1 score cp %d pv %s\n", score, best_move_str);
-            if (root_moves.length == 1) {
-                while (params.infinite && !params.uci_stop_flag);
-                printf("bestmove %s\n", best_move_str);
-                params.is_searching = false;
+            params.first_info_latency = Timer::GetTimeInUs() - params.go_time;
+            // the iterative deepening loop starts at depth 2 and compares its scores with this one
+            if (params.check_timeup)
+                params.time_manager.Update(best_move, score);
+            // a forced move is played right away in a timed game. analysis searches still search it
+            bool analysis = params.num_search_moves > 0 || params.infinite || params.depth_limit > 0 || params.node_limit > 0;
+            if (root_moves.length == 1 && !analysis) {
+                params.WaitForStop();
+                s_deadline_timer->Disarm();
+                SendBestMove(params, best_move);
                 return;
             }
         }
@@ -140,9 +309,9 @@ namespace anka {
                         printf("info depth 1 score cp 0 pv %s\n", best_move_str);
                     }
 
-                    while (params.infinite && !params.uci_stop_flag);
-                    printf("bestmove %s\n", best_move_str);
-                    params.is_searching = false;
+                    params.WaitForStop();
+                    s_deadline_timer->Disarm();
+                    SendBestMove(params, best_move);
                     return;
                 }
             }
@@ -153,86 +322,179 @@ namespace anka {
             max_depth = params.depth_limit;
         }
 
+        // go mate: PVS prunes and reduces the lines a deep forced mate needs, use the mate solver instead
+        if (params.mate_limit > 0) {
+            MateResult mate_result = SolveMate(pos, params.mate_limit, params);
+            if (mate_result.found) {
+                mate_result.Print();
+                params.WaitForStop();
+                s_deadline_timer->Disarm();
+
+                SendBestMove(params, mate_result.pv[0], mate_result.pv_length > 1 ? mate_result.pv[1] : move::NO_MOVE);
+                return;
+            }
+
+            // no forced mate, fall back to a normal search. without other limits search as deep as the mate
+            if (!mate_result.stopped)
+                printf("info string no mate in %d found\n", params.mate_limit);
+            if (params.depth_limit == 0 && !params.check_timeup && !params.infinite)
+                max_depth = Min(2 * params.mate_limit, MAX_DEPTH);
+        }
+
+        int num_lines = Min(params.multi_pv, root_moves.length);
+        Move* line_moves = excluded_moves + num_base_excluded;
+
+        // Parallel search: the helpers search the same root until the main thread is done
+        int num_helpers = Min(params.num_threads - 1, helpers.Size());
+        bool abdada = num_helpers > 0 && params.parallel_mode == ParallelMode::ABDADA;
+        search_node_limit = params.node_limit;
+        search_nodes.store(0, std::memory_order_relaxed);
+        if (num_helpers > 0) {
+            helper_params.Clear();
+            helper_params.parallel_mode = params.parallel_mode;
+            helper_max_depth = max_depth;
+            helper_excluded_moves = excluded_moves;
+            helper_num_excluded = num_base_excluded;
+            helper_log = search_log;
+            if (abdada) {
+                for (int i = 0; i < BUSY_TABLE_SIZE; i++) {
+                    busy_table[i].store(C64(0), std::memory_order_relaxed);
+                }
+            }
+            helpers.Start(pos, HelperSearch, num_helpers);
+        }
+
         // Iterative deepening loop
+        u64 main_nodes = 0;
         SearchResult result;
         result.total_time = 1;
         result.pv = principal_variation;
-        for (int d = 2; d <= max_depth; d++) {          
-            SearchInstance instance;
-            instance.last_timecheck = Timer::GetTimeInMs();
+        for (int d = 2; d <= max_depth; d++) {
+            int best_score = 0;
+
+            // MultiPV: each line is searched with a full window, excluding the best moves of the previous lines
+            for (int line = 0; line < num_lines; line++) {
+                SearchInstance instance(&stack);
+                instance.excluded_root_moves = excluded_moves;
+                instance.num_excluded_root_moves = num_base_excluded + line;
+                instance.abdada = abdada;
+                instance.log = main_log;
+                instance.ReportNodes(params);
+
+                auto iter_start_time = Timer::GetTimeInMs();
+                int line_score = instance.PVS<PV_NODE, true>(pos, -ANKA_INFINITE, ANKA_INFINITE, d, params);
+                auto iter_end_time = Timer::GetTimeInMs();
+                instance.ReportNodes(params);
+                auto delta_time = iter_end_time - iter_start_time;
+
+                if (IsStopped(params, main_log)) {
+                    break;
+                }
+
+                line_moves[line] = instance.root_best_move;
+                int pv_length = pv_table.ExtractPV(pos, line_moves[line], principal_variation, MAX_PV_LENGTH);
+                if (line == 0) {
+                    best_move = line_moves[0];
+                    best_score = line_score;
+                    ponder_move = (pv_length > 1) ? principal_variation[1] : move::NO_MOVE;
+                }
+
+                result.best_score = line_score;
+                result.depth = d;
+                result.tb_hits += instance.tb_hits;
+                result.total_time += delta_time;
+                main_nodes += instance.nodes_visited;
+                result.total_nodes = main_nodes + HelperNodes(num_helpers);
+                result.nps = result.total_nodes / (result.total_time / 1000.0);
 
-            auto iter_start_time = instance.last_timecheck;
-            int best_score = instance.PVS<PV_NODE, true>(pos, -ANKA_INFINITE, ANKA_INFINITE, d, params);
-            auto iter_end_time = Timer::GetTimeInMs();
-            auto delta_time = iter_end_time - iter_start_time;
+                #ifdef STATS_ENABLED
+                result.fh = instance.num_fail_high;
+                result.fh_f = instance.num_fail_high_first;
+                #endif
 
-            if (params.uci_stop_flag) {
+                result.Print(pos, pv_length, num_lines > 1 ? line + 1 : 0);
+            }
+
+            if (IsStopped(params, main_log)) {
                 break;
             }
 
-            best_move = instance.root_best_move;
-            int pv_length = g_trans_table.ExtractPV(pos, best_move, principal_variation, MAX_PV_LENGTH);
-                
-            result.best_score = best_score;
-            result.depth = d;
-            result.tb_hits += instance.tb_hits;
-            result.total_time += delta_time;
-            result.total_nodes += instance.nodes_visited;
-            result.nps = result.total_nodes / (result.total_time / 1000.0);
-
-            #ifdef STATS_ENABLED
-            result.fh = instance.num_fail_high;
-            result.fh_f = instance.num_fail_high_first;
-            #endif
-
-            result.Print(pos, pv_length);
-                
             if (params.check_timeup) {
-                if (delta_time > params.remaining_time * 5 >> 3) {
+                params.time_manager.Update(best_move, best_score);
+                // keep searching on the opponent's time until ponderhit
+                if (!params.ponder && params.time_manager.SoftTimeUp(Timer::GetTimeInMs())) {
+                    if (search_log)
+                        search_log->soft_stop_depth = d;
                     break;
                 }
             }
-        }     
 
-        // don't return from the search in infinite search mode unless a stop command is received
-        while (params.infinite && !params.uci_stop_flag);
+            if (replaying && search_log->soft_stop_depth == d) {
+                break;
+            }
+        }
+
+        // don't return from the search in infinite or ponder mode unless a stop (or ponderhit) command is received
+        params.WaitForStop();
+        s_deadline_timer->Disarm();
+        if (num_helpers > 0) {
+            helper_params.Stop();
+            helpers.Wait();
+        }
+        params.nodes_searched = main_nodes + HelperNodes(num_helpers);
 
-        move::ToString(best_move, best_move_str);
-        printf("bestmove %s\n", best_move_str);
         STATS(g_trans_table.PrintStatistics());
+        STATS(PrintEvalStatistics());
+        SendBestMove(params, best_move, ponder_move);
+    }
+
+    void SearchInstance::ReportNodes(SearchParams& params)
+    {
+        if (search_node_limit == 0) {
+            node_limit = UINT64_MAX;
+            return;
+        }
 
-        params.is_searching = false;
+        u64 new_nodes = nodes_visited - nodes_reported;
+        u64 total = search_nodes.fetch_add(new_nodes, std::memory_order_relaxed) + new_nodes;
+        nodes_reported = nodes_visited;
+        if (total >= search_node_limit) {
+            params.node_limit_reached.store(true, std::memory_order_relaxed);
+            node_limit = UINT64_MAX;
+        }
+        else {
+            node_limit = nodes_visited + Min(NODE_REPORT_INTERVAL, search_node_limit - total);
+        }
     }
 
     int SearchInstance::Quiescence(GameState& pos, int alpha, int beta, SearchParams& params)
     {
         ANKA_ASSERT(beta > alpha);
         int ply = pos.Ply();
-        if (params.check_timeup && (nodes_visited & nodes_per_time_check) == 0) {
-            CheckTime(params);
-        }
+        if (nodes_visited >= node_limit)
+            ReportNodes(params);
 
-        if (params.uci_stop_flag)
+        if (IsStopped(params, log))
             return alpha;
 
         if (pos.IsDrawn())
             return 0;
 
         if (ply > MAX_PLY)
-            return pos.ClassicalEvaluation();
+            return pos.Evaluate(alpha, beta);
 
 
         if (pos.InCheck()) {
-            s_stack->move_list[ply].GenerateLegalMoves(pos); // all check evasion moves
-            if (s_stack->move_list[ply].length == 0) {
+            stack->move_list[ply].GenerateLegalMoves(pos); // all check evasion moves
+            if (stack->move_list[ply].length == 0) {
                 return -ANKA_MATE + ply;
             }
         }
         else {
-            s_stack->move_list[ply].GenerateLegalCaptures(pos);
+            stack->move_list[ply].GenerateLegalCaptures(pos);
 
             // stand pat
-            int eval = pos.ClassicalEvaluation();
+            int eval = pos.Evaluate(alpha, beta);
             if (eval > alpha) {
                 if (eval >= beta) {
                     return eval;
@@ -242,14 +504,14 @@ namespace anka {
             }
         }
 
-        while (s_stack->move_list[ply].length > 0) {
-            Move move = s_stack->move_list[ply].PopBest();
+        while (stack->move_list[ply].length > 0) {
+            Move move = stack->move_list[ply].PopBest();
             nodes_visited++;
             pos.MakeMove(move);
             int score = -Quiescence(pos, -beta, -alpha, params);
             pos.UndoMove();
 
-            if (params.uci_stop_flag)
+            if (IsStopped(params, log))
                 return alpha;
 
             if (score > alpha) {
@@ -272,11 +534,10 @@ namespace anka {
         int old_alpha = alpha;
 
         if constexpr (!is_root) {
-            if (params.check_timeup && (nodes_visited & nodes_per_time_check) == 0) {
-                CheckTime(params);
-            }
+            if (nodes_visited >= node_limit)
+                ReportNodes(params);
 
-            if (params.uci_stop_flag)
+            if (IsStopped(params, log))
                 return alpha;
 
             if (pos.IsDrawn()) {
@@ -292,7 +553,7 @@ namespace anka {
         Move hash_move = 0;
         int hash_eval = 0;
         NodeType hash_node_type = NodeType::NONE;
-        if (g_trans_table.Get(pos_key, probe_result, ply)) {
+        if (ProbeTT(log, pos_key, probe_result, ply)) {
             hash_move = probe_result.move;
             if constexpr (!is_pv) {
                 hash_eval = probe_result.value;
@@ -317,9 +578,9 @@ namespace anka {
             }
         }      
 
-        bool in_check = s_stack->move_list[ply].GenerateLegalMoves(pos);
+        bool in_check = stack->move_list[ply].GenerateLegalMoves(pos);
         if constexpr (!is_root) {
-            if (s_stack->move_list[ply].length == 0) {
+            if (stack->move_list[ply].length == 0) {
                 if (in_check) {
                     return -ANKA_MATE + ply;
                 }
@@ -351,18 +612,19 @@ namespace anka {
         if constexpr (!is_pv) {
             if (!in_check) {
                 if (pos.AllyNonPawnPieces() > 0) {
+                    // both pruning methods only compare the eval with beta, so a lazy estimate is enough far from it
                     int eval = 0;
                     if (hash_node_type == NodeType::EXACT) {
                         eval = hash_eval;
                     }
                     else if (hash_node_type == NodeType::LOWERBOUND) {
-                        eval = Max(pos.ClassicalEvaluation(), hash_eval);
+                        eval = Max(pos.Evaluate(beta - 1, beta), hash_eval);
                     }
                     else if (hash_node_type == NodeType::UPPERBOUND) {
-                        eval = Min(pos.ClassicalEvaluation(), hash_eval);
+                        eval = Min(pos.Evaluate(beta - 1, beta), hash_eval);
                     }
                     else {
-                        eval = pos.ClassicalEvaluation();
+                        eval = pos.Evaluate(beta - 1, beta);
                     }
 
                     auto eval_margin = eval - beta;
@@ -397,28 +659,54 @@ namespace anka {
             // internal iterative deepening
             if (hash_move == move::NO_MOVE && depth > 7) {
                 PVS<PV_NODE>(pos, alpha, beta, depth >> 1, params);
-                if (g_trans_table.Get(pos_key, probe_result, ply)) {
+                if (ProbeTT(log, pos_key, probe_result, ply)) {
                     hash_move = probe_result.move;
                 }
             }
         }
 
-        s_stack->move_list[ply].GenerateLegalMoves(pos);
+        stack->move_list[ply].GenerateLegalMoves(pos);
+        bool tt_store_disabled = false;
+        if constexpr (is_root) {
+            // the root result isn't stored when some moves are excluded, it isn't the true score of the position
+            for (int i = 0; i < num_excluded_root_moves; i++) {
+                stack->move_list[ply].Remove(excluded_root_moves[i]);
+            }
+            tt_store_disabled = num_excluded_root_moves > 0;
+        }
+
         int moves_made = 0;
         Move best_move = move::NO_MOVE;
         int best_score = -ANKA_INFINITE;
-        while (s_stack->move_list[ply].length > 0) {
+
+        // ABDADA: moves that another thread is searching are deferred until the rest are searched
+        Move deferred_moves[MAX_DEFERRED_MOVES];
+        int num_deferred = 0;
+        int deferred_index = 0;
+        while (stack->move_list[ply].length > 0 || deferred_index < num_deferred) {
             Move move = move::NO_MOVE;
             int score = -ANKA_INFINITE;
+            u64 move_hash = 0;
 
             if (moves_made == 0) {
-                move = s_stack->move_list[ply].PopBest(hash_move,
-                    killers.moves[ply][0], killers.moves[ply][1]);
+                move = stack->move_list[ply].PopBest(hash_move,
+                    stack->killers.moves[ply][0], stack->killers.moves[ply][1]);
                 pos.MakeMove(move);
                 score = -PVS<is_pv>(pos, -beta, -alpha, depth - 1, params);
             }
             else {
-                move = s_stack->move_list[ply].PopBest();
+                bool is_deferred = stack->move_list[ply].length == 0;
+                move = is_deferred ? deferred_moves[deferred_index++] : stack->move_list[ply].PopBest();
+
+                if (abdada && depth >= ABDADA_MIN_DEPTH) {
+                    move_hash = MoveHash(pos_key, move);
+                    if (!is_deferred && num_deferred < MAX_DEFERRED_MOVES && IsMoveBusy(log, move_hash)) {
+                        deferred_moves[num_deferred++] = move;
+                        continue;
+                    }
+                    SetBusy(move_hash);
+                }
+
                 pos.MakeMove(move);
 
                 int reduction = 0;
@@ -435,6 +723,8 @@ namespace anka {
                     score = -PVS<PV_NODE>(pos, -beta, -alpha, depth - 1, params);
             }
             pos.UndoMove();
+            if (move_hash)
+                ClearBusy(move_hash);
             moves_made++;
             nodes_visited++;
 
@@ -447,26 +737,26 @@ namespace anka {
                 if (score >= beta) {
                     STATS(num_fail_high++); STATS(num_fail_high_first++);    
                     if (!in_check && move::IsQuiet(move)) {
-                        killers.Put(move, ply);
+                        stack->killers.Put(move, ply);
                     }
-                    g_trans_table.Put(pos_key, NodeType::LOWERBOUND, depth, move, score, ply, params.uci_stop_flag);
+                    StoreTT(log, pos_key, NodeType::LOWERBOUND, depth, move, score, ply, IsStopped(params, log) || tt_store_disabled);
                     return score;
                 }
                 ANKA_ASSERT(is_pv);
                 alpha = score;
             }
 
-            if (params.uci_stop_flag)
+            if (IsStopped(params, log))
                 return best_score;
         }
 
 
         if (best_score > old_alpha) {
             ANKA_ASSERT(is_pv);
-            g_trans_table.Put(pos_key, NodeType::EXACT, depth, best_move, best_score, ply, params.uci_stop_flag);
+            StoreTT(log, pos_key, NodeType::EXACT, depth, best_move, best_score, ply, IsStopped(params, log) || tt_store_disabled);
         }
         else {
-            g_trans_table.Put(pos_key, NodeType::UPPERBOUND, depth, best_move, best_score, ply, params.uci_stop_flag);
+            StoreTT(log, pos_key, NodeType::UPPERBOUND, depth, best_move, best_score, ply, IsStopped(params, log) || tt_store_disabled);
         }
 
         if constexpr (is_root) {
@@ -4,13 +4,20 @@
 #include "movegen.hpp"
 #include "engine_settings.hpp"
 #include "timer.hpp"
+#include "timeman.hpp"
 #include "ttable.hpp"
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 
 namespace anka {
+    class HelperPool;
+    class SearchLog;
+    class ThreadLog;
+
     bool InitSearch();
-    void FreeSearchStack();
+    void FreeSearch();
 
 
     struct SearchResult {
@@ -24,12 +31,17 @@ namespace anka {
         u64 fh = C64(1);
         u64 fh_f = C64(1);
 
-        void Print(GameState& pos, int pv_length) const
+        // multipv: index of the line starting from 1, 0 if not in MultiPV mode
+        void Print(GameState& pos, int pv_length, int multipv = 0) const
         {
             char move_str[6];
 
-            printf("info depth %d time %lld nodes %" PRIu64 " nps %" PRIu64 " tbhits %" PRIu64 " score ",
-                depth, total_time, total_nodes,
+            printf("info depth %d ", depth);
+            if (multipv > 0)
+                printf("multipv %d ", multipv);
+
+            printf("time %lld nodes %" PRIu64 " nps %" PRIu64 " tbhits %" PRIu64 " score ",
+                total_time, total_nodes,
                 nps, tb_hits);
 
             if (best_score >= UPPER_MATE_THRESHOLD) {
@@ -57,48 +69,128 @@ namespace anka {
 
     struct SearchParams {
         bool infinite = false;
-        long long start_time = 0;
-        long long remaining_time = 0;
+        std::atomic<bool> ponder = false;
         int depth_limit = 0;
+        int multi_pv = 1;
+        u64 node_limit = 0; // 0: no limit
+        int mate_limit = 0; // go mate, in moves. solved with the df-pn mate solver
+        int num_threads = 1;
+        ParallelMode parallel_mode = ParallelMode::LAZY;
+        SearchLog* log = nullptr; // records or replays the search if set
+        Move search_moves[kMoveListMaxSize]{}; // go searchmoves, the root moves to search. all moves if empty
+        int num_search_moves = 0;
+        TimeManager time_manager;
+        long long go_time = 0; // time the go command was received, in microseconds
+        long long first_info_latency = 0; // microseconds from go to the first info output
+        u64 nodes_searched = 0; // by all threads, set when the search is finished
 
         bool check_timeup = false;
         std::atomic<bool> uci_stop_flag = false;
+        std::atomic<bool> node_limit_reached = false; // ends the search, but not the wait for stop or ponderhit
         std::atomic<bool> is_searching = false;
 
+        // Called from the search hot path. The flags are set by the UCI thread, the deadline timer or the search.
+        force_inline bool Stopped() const
+        {
+            return uci_stop_flag.load(std::memory_order_relaxed) || node_limit_reached.load(std::memory_order_relaxed);
+        }
+
+        // Sets the stop flag and wakes up a search waiting in WaitForStop
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(stop_mutex);
+                uci_stop_flag = true;
+            }
+            stop_cv.notify_all();
+        }
+
+        // Switches a ponder search to a normal search and wakes up a search waiting in WaitForStop
+        void StopPondering()
+        {
+            {
+                std::lock_guard<std::mutex> lock(stop_mutex);
+                ponder = false;
+            }
+            stop_cv.notify_all();
+        }
+
+        // Infinite and ponder searches that finish early wait here before sending bestmove.
+        // Blocks without using the CPU until Stop or StopPondering is called.
+        void WaitForStop()
+        {
+            std::unique_lock<std::mutex> lock(stop_mutex);
+            stop_cv.wait(lock, [this] { return uci_stop_flag.load() || !(infinite || ponder.load()); });
+        }
+
         void Clear()
         {
             infinite = false;
-            start_time = 0;
-            remaining_time = 0;
+            ponder = false;
             depth_limit = 0;
+            multi_pv = 1;
+            node_limit = 0;
+            mate_limit = 0;
+            num_threads = 1;
+            parallel_mode = ParallelMode::LAZY;
+            log = nullptr;
+            num_search_moves = 0;
+            time_manager.Clear();
+            go_time = 0;
+            first_info_latency = 0;
+            nodes_searched = 0;
 
             check_timeup = false;
             uci_stop_flag = false;
+            node_limit_reached = false;
             is_searching = false;
         }
+    private:
+        std::mutex stop_mutex;
+        std::condition_variable stop_cv;
     };
 
+    // Per-thread search state
     struct SearchStack {
         MoveList<256> move_list[MAX_PLY + 1]{};
+        KillersTable killers;
     };
 
 	class SearchInstance {
     public:
+        explicit SearchInstance(SearchStack* search_stack) : stack{ search_stack } {}
+
         int Quiescence(GameState& pos, int alpha, int beta, SearchParams& params);
         template <bool is_pv, bool is_root=false>
         int PVS(GameState& pos, int alpha, int beta, int depth, SearchParams& params);
+
+        // Adds the nodes visited since the last report to the node count of all threads.
+        // Sets params.node_limit_reached at the go nodes limit, otherwise sets the next report point.
+        void ReportNodes(SearchParams& params);
 	public:
         u64 nodes_visited = C64(0);
         u64 tb_hits = 0;
         u64 num_fail_high = C64(1);
         u64 num_fail_high_first = C64(1);
-        long long last_timecheck = 0;
         Move root_best_move = move::NO_MOVE;
         bool nmp_enabled = true;
+        bool abdada = false; // defer moves searched by other threads
+        ThreadLog* log = nullptr; // routes shared state through the search log while recording or replaying
+
+        u64 node_limit = UINT64_MAX; // ReportNodes is called when nodes_visited reaches this
+        u64 nodes_reported = 0;
+
+        // root moves that are skipped. used by searchmoves and by MultiPV to search for the next best line
+        const Move* excluded_root_moves = nullptr;
+        int num_excluded_root_moves = 0;
     private:
-        void CheckTime(SearchParams& params);
+        SearchStack* stack;
 	}; // SearchInstance
 
 
-    void StartSearch(GameState& root_pos, SearchParams& params);
+    // Searches on the calling thread. The helpers join in when params.num_threads > 1.
+    void StartSearch(GameState& root_pos, SearchParams& params, SearchStack& stack, HelperPool& helpers);
+
+    // Handles the ponderhit command. Starts the clock of a running ponder search.
+    void PonderHit(SearchParams& params);
 }
\ No newline at end of file
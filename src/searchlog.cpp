@@ -0,0 +1,195 @@
+#include "searchlog.hpp"
+#include <stdio.h>
+#include <string.h>
+
+namespace anka {
+	namespace {
+		// the private tables must have the same size while recording and replaying
+		constexpr size_t PRIVATE_TABLE_SIZE = 4; // MiB, kept small so that clearing it doesn't delay the search
+		constexpr char LOG_MAGIC[8] = { 'A', 'N', 'K', 'A', 'L', 'O', 'G', '1' };
+
+		template <typename T>
+		bool Write(FILE* file, const T* data, size_t count)
+		{
+			return fwrite(data, sizeof(T), count, file) == count;
+		}
+
+		template <typename T>
+		bool Read(FILE* file, T* data, size_t count)
+		{
+			return fread(data, sizeof(T), count, file) == count;
+		}
+
+		bool WriteString(FILE* file, const std::string& str)
+		{
+			u32 length = static_cast<u32>(str.size());
+			return Write(file, &length, 1) && Write(file, str.data(), length);
+		}
+
+		bool ReadString(FILE* file, std::string& str)
+		{
+			u32 length;
+			if (!Read(file, &length, 1))
+				return false;
+
+			str.resize(length);
+			return Read(file, &str[0], length);
+		}
+	}
+
+	bool ThreadLog::Begin(LogMode mode)
+	{
+		if (!m_private_table) {
+			m_private_table = new TranspositionTable();
+			if (!m_private_table->Init(PRIVATE_TABLE_SIZE)) {
+				delete m_private_table;
+				m_private_table = nullptr;
+				return false;
+			}
+		}
+		m_private_table->Clear();
+
+		m_mode = mode;
+		if (mode == LogMode::RECORD) {
+			m_probes.clear();
+			m_busy_hits.clear();
+			m_stop_check = 0;
+		}
+
+		m_probe_seq = 0;
+		m_busy_seq = 0;
+		m_stop_seq = 0;
+		m_probe_index = 0;
+		m_busy_index = 0;
+		return true;
+	}
+
+	bool SearchLog::BeginRecord(const char* path, const char* position_command, const char* go_command, const EngineSettings& options)
+	{
+		m_mode = LogMode::RECORD;
+		m_path = std::string(path) + "." + std::to_string(++m_num_recorded);
+		m_position_command = position_command;
+		m_go_command = go_command;
+		m_num_threads = options.num_threads;
+		m_parallel_mode = options.parallel_mode;
+		m_multi_pv = options.multi_pv;
+		soft_stop_depth = 0;
+
+		for (int i = 0; i < m_num_threads; i++) {
+			if (!m_threads[i].Begin(LogMode::RECORD)) {
+				fprintf(stderr, "AnkaError(SearchLog): Failed to allocate private transposition table\n");
+				m_mode = LogMode::OFF;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool SearchLog::BeginReplay()
+	{
+		m_mode = LogMode::REPLAY;
+		for (int i = 0; i < m_num_threads; i++) {
+			if (!m_threads[i].Begin(LogMode::REPLAY)) {
+				fprintf(stderr, "AnkaError(SearchLog): Failed to allocate private transposition table\n");
+				m_mode = LogMode::OFF;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool SearchLog::Save(const char* path)
+	{
+		FILE* file = fopen(path, "wb");
+		if (!file) {
+			fprintf(stderr, "AnkaError(SearchLog): Failed to open %s\n", path);
+			return false;
+		}
+
+		i32 header[4] = { m_num_threads, static_cast<i32>(m_parallel_mode), m_multi_pv, soft_stop_depth };
+		bool ok = Write(file, LOG_MAGIC, sizeof(LOG_MAGIC))
+			&& WriteString(file, m_position_command)
+			&& WriteString(file, m_go_command)
+			&& Write(file, header, 4);
+
+		for (int i = 0; i < m_num_threads && ok; i++) {
+			ThreadLog& thread = m_threads[i];
+			u64 counters[5] = { thread.m_probe_seq, thread.m_stop_seq, thread.m_stop_check,
+				thread.m_probes.size(), thread.m_busy_hits.size() };
+
+			ok = Write(file, counters, 5)
+				&& Write(file, thread.m_probes.data(), thread.m_probes.size())
+				&& Write(file, thread.m_busy_hits.data(), thread.m_busy_hits.size());
+		}
+
+		fclose(file);
+		if (!ok)
+			fprintf(stderr, "AnkaError(SearchLog): Failed to write %s\n", path);
+		return ok;
+	}
+
+	bool SearchLog::Load(const char* path)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file) {
+			fprintf(stderr, "AnkaError(SearchLog): Failed to open %s\n", path);
+			return false;
+		}
+
+		char magic[sizeof(LOG_MAGIC)];
+		i32 header[4];
+		bool ok = Read(file, magic, sizeof(magic))
+			&& memcmp(magic, LOG_MAGIC, sizeof(LOG_MAGIC)) == 0
+			&& ReadString(file, m_position_command)
+			&& ReadString(file, m_go_command)
+			&& Read(file, header, 4)
+			&& header[0] >= EngineSettings::MIN_THREADS && header[0] <= EngineSettings::MAX_THREADS;
+
+		if (ok) {
+			m_num_threads = header[0];
+			m_parallel_mode = static_cast<ParallelMode>(header[1]);
+			m_multi_pv = header[2];
+			soft_stop_depth = header[3];
+		}
+
+		for (int i = 0; i < m_num_threads && ok; i++) {
+			ThreadLog& thread = m_threads[i];
+			u64 counters[5];
+			ok = Read(file, counters, 5);
+			if (!ok)
+				break;
+
+			thread.m_recorded_probes = counters[0];
+			thread.m_recorded_stop_checks = counters[1];
+			thread.m_stop_check = counters[2];
+			thread.m_probes.resize(counters[3]);
+			thread.m_busy_hits.resize(counters[4]);
+			ok = Read(file, thread.m_probes.data(), thread.m_probes.size())
+				&& Read(file, thread.m_busy_hits.data(), thread.m_busy_hits.size());
+		}
+
+		fclose(file);
+		m_mode = LogMode::OFF;
+		if (!ok)
+			fprintf(stderr, "AnkaError(SearchLog): %s is not a valid search log\n", path);
+		return ok;
+	}
+
+	bool SearchLog::ReplayMatches() const
+	{
+		for (int i = 0; i < m_num_threads; i++) {
+			const ThreadLog& thread = m_threads[i];
+			if (thread.m_probe_seq != thread.m_recorded_probes
+				|| thread.m_stop_seq != thread.m_recorded_stop_checks
+				|| thread.m_probe_index != thread.m_probes.size()
+				|| thread.m_busy_index != thread.m_busy_hits.size())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
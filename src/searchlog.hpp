@@ -0,0 +1,165 @@
+#pragma once
+#include "core.hpp"
+#include "engine_settings.hpp"
+#include "ttable.hpp"
+#include <string>
+#include <vector>
+
+namespace anka {
+	enum class LogMode { OFF, RECORD, REPLAY };
+
+	// A transposition table probe whose shared table result differed from the thread's private table
+	struct ProbeRecord {
+		u64 seq; // probe number in the thread
+		u32 hit;
+		TTRecord record;
+	};
+	static_assert(sizeof(ProbeRecord) == 24, "ProbeRecord: unexpected struct alignment");
+
+	/* Everything a search thread receives from the other threads and the clock:
+	* shared transposition table results, ABDADA busy flags and the point where it saw the stop flag.
+	*
+	* While recording, each thread keeps a private table with only its own writes (what the thread
+	* would see if it searched alone) next to the shared one. Only the probes where the two differ are
+	* logged, so the log stays small. A replay runs each thread on its private table and substitutes
+	* the logged results, which reproduces the recorded tree without the other threads or the clock.
+	* Events are identified by per-thread counters instead of node counts, since several probes and
+	* stop checks can happen between two node count increments.
+	*/
+	class ThreadLog {
+	public:
+		ThreadLog() = default;
+		~ThreadLog() { delete m_private_table; }
+		ThreadLog(const ThreadLog&) = delete;
+		ThreadLog& operator=(const ThreadLog&) = delete;
+
+		force_inline bool Probe(u64 pos_key, TTRecord& result, int ply)
+		{
+			m_probe_seq++;
+			if (m_mode == LogMode::RECORD) {
+				bool hit = g_trans_table.Get(pos_key, result, ply);
+				TTRecord private_result;
+				bool private_hit = m_private_table->Get(pos_key, private_result, ply);
+				if (hit != private_hit || (hit && !SameRecord(result, private_result))) {
+					m_probes.push_back({ m_probe_seq, hit, result });
+				}
+				return hit;
+			}
+
+			if (m_probe_index < m_probes.size() && m_probes[m_probe_index].seq == m_probe_seq) {
+				const ProbeRecord& rec = m_probes[m_probe_index++];
+				result = rec.record;
+				return rec.hit;
+			}
+			return m_private_table->Get(pos_key, result, ply);
+		}
+
+		force_inline void Store(u64 pos_key, NodeType type, int depth, Move best_move, i16 value, int ply, bool timeup)
+		{
+			if (m_mode == LogMode::RECORD)
+				g_trans_table.Put(pos_key, type, depth, best_move, value, ply, timeup);
+			m_private_table->Put(pos_key, type, depth, best_move, value, ply, timeup);
+		}
+
+		force_inline bool Busy(bool is_busy)
+		{
+			m_busy_seq++;
+			if (m_mode == LogMode::RECORD) {
+				if (is_busy)
+					m_busy_hits.push_back(m_busy_seq);
+				return is_busy;
+			}
+
+			if (m_busy_index < m_busy_hits.size() && m_busy_hits[m_busy_index] == m_busy_seq) {
+				m_busy_index++;
+				return true;
+			}
+			return false;
+		}
+
+		force_inline bool Stopped(bool stop_flag)
+		{
+			m_stop_seq++;
+			if (m_mode == LogMode::RECORD) {
+				if (stop_flag && m_stop_check == 0)
+					m_stop_check = m_stop_seq;
+				return stop_flag;
+			}
+
+			return m_stop_check != 0 && m_stop_seq >= m_stop_check;
+		}
+
+		TranspositionTable& PrivateTable() { return *m_private_table; }
+	private:
+		friend class SearchLog;
+
+		static force_inline bool SameRecord(const TTRecord& a, const TTRecord& b)
+		{
+			// the age isn't used by the search
+			return a.move == b.move && a.value == b.value && a.depth == b.depth
+				&& a.GetNodeType() == b.GetNodeType();
+		}
+
+		bool Begin(LogMode mode);
+
+		LogMode m_mode = LogMode::OFF;
+		TranspositionTable* m_private_table = nullptr;
+
+		std::vector<ProbeRecord> m_probes;
+		std::vector<u64> m_busy_hits;
+		u64 m_stop_check = 0; // stop check that first saw the stop flag, 0 if never
+
+		u64 m_probe_seq = 0;
+		u64 m_busy_seq = 0;
+		u64 m_stop_seq = 0;
+		size_t m_probe_index = 0;
+		size_t m_busy_index = 0;
+
+		// counters at the end of the recorded search, to verify a replay
+		u64 m_recorded_probes = 0;
+		u64 m_recorded_stop_checks = 0;
+	};
+
+	/* The record of one search: the UCI commands that started it, the decisions the main thread made
+	* with the clock and a ThreadLog per search thread. Saved to and loaded from a binary file.
+	*/
+	class SearchLog {
+	public:
+		SearchLog() = default;
+		SearchLog(const SearchLog&) = delete;
+		SearchLog& operator=(const SearchLog&) = delete;
+
+		// 'position_command' and 'go_command' are the command lines without the command names.
+		// The recording is saved to "<path>.<n>" where n is the number of the recorded search.
+		bool BeginRecord(const char* path, const char* position_command, const char* go_command, const EngineSettings& options);
+		bool BeginReplay();
+
+		bool Save(const char* path);
+		bool Load(const char* path);
+
+		// True if every thread of the replay made the same probes and stop checks as the recording
+		bool ReplayMatches() const;
+
+		ThreadLog* Thread(int thread_id) { return &m_threads[thread_id]; }
+		LogMode Mode() const { return m_mode; }
+		const char* Path() const { return m_path.c_str(); }
+		const char* PositionCommand() const { return m_position_command.c_str(); }
+		const char* GoCommand() const { return m_go_command.c_str(); }
+		int NumThreads() const { return m_num_threads; }
+		ParallelMode GetParallelMode() const { return m_parallel_mode; }
+		int MultiPV() const { return m_multi_pv; }
+
+		// depth of the iteration after which the main thread stopped because of the soft time limit. 0 if it didn't.
+		int soft_stop_depth = 0;
+	private:
+		LogMode m_mode = LogMode::OFF;
+		std::string m_path;
+		int m_num_recorded = 0;
+		std::string m_position_command;
+		std::string m_go_command;
+		int m_num_threads = 1;
+		ParallelMode m_parallel_mode = ParallelMode::LAZY;
+		int m_multi_pv = 1;
+		ThreadLog m_threads[EngineSettings::MAX_THREADS];
+	};
+}
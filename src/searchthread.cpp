@@ -0,0 +1,173 @@
+#include "searchthread.hpp"
+#include "searchlog.hpp"
+#include "util.hpp"
+
+namespace anka {
+	HelperPool::~HelperPool()
+	{
+		Free();
+	}
+
+	bool HelperPool::Init(int num_helpers)
+	{
+		Free();
+		num_helpers = Clamp(num_helpers, 0, EngineSettings::MAX_THREADS - 1);
+
+		for (int i = 0; i < num_helpers; i++) {
+			Helper* helper = new Helper();
+			helper->stack = (SearchStack*)malloc(sizeof(SearchStack));
+			if (!helper->stack) {
+				fprintf(stderr, "Failed to allocate search stack memory\n");
+				delete helper;
+				Free();
+				return false;
+			}
+
+			m_helpers[i] = helper;
+			m_num_helpers++;
+			helper->thread = std::thread(&HelperPool::IdleLoop, this, i);
+		}
+
+		return true;
+	}
+
+	void HelperPool::Start(const GameState& pos, Job job, int num_helpers)
+	{
+		Wait();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = job;
+			for (int i = 0; i < Min(num_helpers, m_num_helpers); i++) {
+				m_helpers[i]->pos.CopyFrom(pos);
+				m_helpers[i]->searching = true;
+			}
+		}
+		m_cv.notify_all();
+	}
+
+	void HelperPool::Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (int i = 0; i < m_num_helpers; i++) {
+			m_cv.wait(lock, [this, i] { return !m_helpers[i]->searching; });
+		}
+	}
+
+	void HelperPool::IdleLoop(int helper_id)
+	{
+		Helper* helper = m_helpers[helper_id];
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_cv.wait(lock, [this, helper] { return helper->searching || m_exit; });
+			if (m_exit)
+				return;
+
+			Job job = m_job;
+			lock.unlock();
+			job(helper_id, helper->pos, *helper->stack);
+			lock.lock();
+
+			helper->searching = false;
+			m_cv.notify_all();
+		}
+	}
+
+	void HelperPool::Free()
+	{
+		Wait();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_cv.notify_all();
+
+		for (int i = 0; i < m_num_helpers; i++) {
+			m_helpers[i]->thread.join();
+			free(m_helpers[i]->stack);
+			delete m_helpers[i];
+			m_helpers[i] = nullptr;
+		}
+
+		m_num_helpers = 0;
+		m_exit = false;
+	}
+
+	SearchThread::~SearchThread()
+	{
+		if (m_thread.joinable()) {
+			Wait();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_exit = true;
+			}
+			m_cv.notify_all();
+			m_thread.join();
+		}
+
+		free(m_stack);
+	}
+
+	bool SearchThread::Init()
+	{
+		m_stack = (SearchStack*)malloc(sizeof(SearchStack));
+		if (!m_stack) {
+			fprintf(stderr, "Failed to allocate search stack memory\n");
+			return false;
+		}
+
+		m_thread = std::thread(&SearchThread::IdleLoop, this);
+		return true;
+	}
+
+	void SearchThread::Go(GameState& pos, SearchParams& params)
+	{
+		Wait();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pos = &pos;
+			m_params = &params;
+			m_searching = true;
+		}
+		m_cv.notify_all();
+	}
+
+	void SearchThread::Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this] { return !m_searching; });
+	}
+
+	bool SearchThread::SetNumThreads(int num_threads)
+	{
+		Wait();
+		return m_helpers.Init(num_threads - 1);
+	}
+
+	void SearchThread::IdleLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_cv.wait(lock, [this] { return m_searching || m_exit; });
+			if (m_exit)
+				return;
+
+			lock.unlock();
+			SearchLog* log = m_params->log;
+			StartSearch(*m_pos, *m_params, *m_stack, m_helpers);
+			if (log && log->Mode() == LogMode::RECORD)
+				log->Save(log->Path());
+			lock.lock();
+
+			long long latency = m_params->first_info_latency;
+			if (latency > 0) {
+				m_num_searches++;
+				m_total_latency += latency;
+				m_max_latency = Max(m_max_latency, latency);
+				STATS(printf("First info latency: %lld us (average %lld us, max %lld us)\n", latency, AverageLatency(), m_max_latency));
+			}
+
+			m_searching = false;
+			m_cv.notify_all();
+		}
+	}
+}
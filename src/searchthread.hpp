@@ -0,0 +1,96 @@
+#pragma once
+#include "search.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace anka {
+	/* Parked helper threads for parallel search. Each helper owns a search stack and a copy of the
+	* root position, and runs the given job until it returns. Like SearchThread, the threads are
+	* only created when the thread count changes.
+	*/
+	class HelperPool {
+	public:
+		using Job = void (*)(int helper_id, GameState& pos, SearchStack& stack);
+
+		HelperPool() = default;
+		~HelperPool();
+		HelperPool(const HelperPool&) = delete;
+		HelperPool& operator=(const HelperPool&) = delete;
+
+		// Stops the current helpers and starts 'num_helpers' new ones
+		bool Init(int num_helpers);
+
+		// Runs 'job' on the first 'num_helpers' helpers, each with a copy of 'pos'
+		void Start(const GameState& pos, Job job, int num_helpers);
+
+		// Blocks until every helper has returned from its job
+		void Wait();
+
+		int Size() const { return m_num_helpers; }
+	private:
+		struct Helper {
+			std::thread thread;
+			GameState pos;
+			SearchStack* stack = nullptr;
+			bool searching = false;
+		};
+
+		void IdleLoop(int helper_id);
+		void Free();
+
+		Helper* m_helpers[EngineSettings::MAX_THREADS]{};
+		int m_num_helpers = 0;
+		Job m_job = nullptr;
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		bool m_exit = false;
+	};
+
+	/* A long-lived worker that runs StartSearch. The thread is created once and parked on a
+	* condition variable between searches, so a "go" command doesn't pay for thread creation and
+	* the search stack stays allocated (and warm in the cache) across searches.
+	*/
+	class SearchThread {
+	public:
+		SearchThread() = default;
+		~SearchThread();
+		SearchThread(const SearchThread&) = delete;
+		SearchThread& operator=(const SearchThread&) = delete;
+
+		// Allocates the search stack and starts the worker thread
+		bool Init();
+
+		// Starts searching 'pos' on the worker thread. Waits for the previous search to finish first.
+		void Go(GameState& pos, SearchParams& params);
+
+		// Blocks until the current search (if any) is finished
+		void Wait();
+
+		// Total number of search threads, including this one. Call only while not searching.
+		bool SetNumThreads(int num_threads);
+		int NumThreads() const { return m_helpers.Size() + 1; }
+
+		// go to first info latency statistics, in microseconds
+		u64 NumSearches() const { return m_num_searches; }
+		long long AverageLatency() const { return m_num_searches ? m_total_latency / static_cast<long long>(m_num_searches) : 0; }
+		long long MaxLatency() const { return m_max_latency; }
+	private:
+		void IdleLoop();
+
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		bool m_searching = false;
+		bool m_exit = false;
+
+		GameState* m_pos = nullptr;
+		SearchParams* m_params = nullptr;
+		SearchStack* m_stack = nullptr;
+		HelperPool m_helpers;
+
+		u64 m_num_searches = 0;
+		long long m_total_latency = 0;
+		long long m_max_latency = 0;
+	};
+}
@@ -0,0 +1,432 @@
+#include "bench.hpp"
+#include "evaluation.hpp"
+#include "movegen.hpp"
+#include "packedpos.hpp"
+#include "search.hpp"
+#include "timer.hpp"
+#include "ttable.hpp"
+#include "util.hpp"
+#include <ctype.h>
+#include <stdlib.h>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace anka {
+	namespace {
+		constexpr const char* bench_fens[] = {
+			"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+			"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+			"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+			"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+			"r1bqkb1r/pp3ppp/2n1pn2/2pp4/3P4/2PBPN2/PP1N1PPP/R1BQK2R w KQkq - 0 7",
+			"2r3k1/5pp1/p3p2p/1p1nP3/3P4/P2B1P2/1P3P1P/2R3K1 w - - 0 28",
+			"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+			"6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"
+		};
+
+		struct SliderSet {
+			Square squares[32];
+			PieceType pieces[32];
+			int count = 0;
+			Bitboard occupancy = 0;
+		};
+
+		Bitboard SliderAttacksScalar(Square sq, PieceType piece, Bitboard occupancy)
+		{
+			switch (piece)
+			{
+			case BISHOP:
+				return attacks::BishopAttacks(sq, occupancy);
+			case ROOK:
+				return attacks::RookAttacks(sq, occupancy);
+			default:
+				return attacks::QueenAttacks(sq, occupancy);
+			}
+		}
+
+		// Returns the fen of the position with the colors swapped and the board flipped vertically.
+		// The mirrored position has the same evaluation from the side to play's perspective.
+		std::string MirrorFen(const char* fen)
+		{
+			char placement[128], side[4], castling[8], ep[4];
+			int halfmove = 0, fullmove = 1;
+			sscanf(fen, "%127s %3s %7s %3s %d %d", placement, side, castling, ep, &halfmove, &fullmove);
+
+			std::string ranks[8];
+			int rank = 0;
+			for (const char* c = placement; *c && rank < 8; c++) {
+				if (*c == '/')
+					rank++;
+				else
+					ranks[rank] += isalpha(*c) ? static_cast<char>(isupper(*c) ? tolower(*c) : toupper(*c)) : *c;
+			}
+
+			std::string mirrored;
+			for (int r = 7; r >= 0; r--) {
+				mirrored += ranks[r];
+				if (r > 0)
+					mirrored += '/';
+			}
+			mirrored += side[0] == 'w' ? " b " : " w ";
+
+			// uppercase rights first as in KQkq
+			std::string rights;
+			for (const char* c = castling; *c; c++)
+				if (*c != '-' && islower(*c))
+					rights += static_cast<char>(toupper(*c));
+			for (const char* c = castling; *c; c++)
+				if (*c != '-' && isupper(*c))
+					rights += static_cast<char>(tolower(*c));
+			mirrored += rights.empty() ? "-" : rights;
+
+			mirrored += ' ';
+			if (ep[0] == '-')
+				mirrored += '-';
+			else {
+				mirrored += ep[0];
+				mirrored += static_cast<char>('1' + '8' - ep[1]);
+			}
+			mirrored += " " + std::to_string(halfmove) + " " + std::to_string(fullmove);
+			return mirrored;
+		}
+
+		// The lazy estimate of ClassicalEvaluation: a window above any evaluation forces the lazy exit
+		int LazyEstimate(const GameState& pos)
+		{
+			int saved_margin = g_lazy_eval_margin;
+			g_lazy_eval_margin = 0;
+			ClearEvalCache();
+			int estimate = pos.ClassicalEvaluation(ANKA_INFINITE - 2, ANKA_INFINITE - 1);
+			g_lazy_eval_margin = saved_margin;
+			return estimate;
+		}
+
+		/* Checks the lazy estimate and the full evaluation of each position against its color mirrored
+		* position. Both are from the side to play's perspective, so a term with the wrong sign for one color
+		* (such as the tempo bonus) makes them differ. The taper rounds toward negative infinity, so the colors may
+		* differ by 1. Returns false on the first mismatch.
+		*/
+		bool CheckLazyEvaluation(const std::vector<std::unique_ptr<GameState>>& positions)
+		{
+			int max_lazy_error = 0;
+			char fen[256];
+			GameState mirror;
+			for (size_t i = 0; i < positions.size(); i++) {
+				GameState& pos = *positions[i];
+				pos.ToFen(fen);
+				if (!mirror.LoadPosition(MirrorFen(fen))) {
+					fprintf(stderr, "AnkaError(Bench): Failed to mirror position %zu\n", i);
+					return false;
+				}
+
+				ClearEvalCache();
+				int eval = pos.ClassicalEvaluation();
+				ClearEvalCache();
+				int mirror_eval = mirror.ClassicalEvaluation();
+				int estimate = LazyEstimate(pos);
+				int mirror_estimate = LazyEstimate(mirror);
+				if (abs(eval - mirror_eval) > 1 || abs(estimate - mirror_estimate) > 1) {
+					fprintf(stderr, "AnkaError(Bench): Position %zu: evaluation %d / %d and lazy estimate %d / %d differ between colors\n",
+						i, eval, mirror_eval, estimate, mirror_estimate);
+					return false;
+				}
+				max_lazy_error = Max(max_lazy_error, abs(eval - estimate));
+			}
+			ClearEvalCache();
+			printf("Lazy estimate: consistent for both colors, max difference to the evaluation %d\n", max_lazy_error);
+			return true;
+		}
+
+		struct BenchResult {
+			long long time = 0; // ms
+			u64 nodes = 0;
+		};
+
+		BenchResult RunFixedDepth(SearchThread& thread, int depth, int num_threads, ParallelMode mode)
+		{
+			GameState pos;
+			SearchParams params;
+			BenchResult result;
+
+			for (const char* fen : bench_fens) {
+				pos.LoadPosition(fen);
+				g_trans_table.Clear();
+				params.Clear();
+				params.depth_limit = depth;
+				params.num_threads = num_threads;
+				params.parallel_mode = mode;
+				params.is_searching = true;
+				params.go_time = Timer::GetTimeInUs();
+
+				long long start_time = Timer::GetTimeInMs();
+				thread.Go(pos, params);
+				thread.Wait();
+				result.time += Timer::GetTimeInMs() - start_time;
+				result.nodes += params.nodes_searched;
+			}
+
+			result.time = Max(result.time, 1LL);
+			return result;
+		}
+	}
+
+	void RunStopLatencyBench(SearchThread& thread, int movetime)
+	{
+		GameState pos;
+		SearchParams params;
+
+		int num_deadline_stops = 0;
+		long long total_latency = 0;
+		long long max_latency = 0;
+		long long total_info_latency = 0;
+		int num_searches = 0;
+		for (const char* fen : bench_fens) {
+			pos.LoadPosition(fen);
+			params.Clear();
+			params.check_timeup = true;
+			params.is_searching = true;
+			params.go_time = Timer::GetTimeInUs();
+
+			TimeControl tc;
+			tc.movetime = movetime;
+			params.time_manager.Init(tc, 0, params.go_time / 1000);
+
+			thread.Go(pos, params);
+			thread.Wait();
+			long long end_time = Timer::GetTimeInUs();
+			total_info_latency += params.first_info_latency;
+			num_searches++;
+
+			// searches that finished between iterations weren't stopped by the deadline
+			if (!params.Stopped())
+				continue;
+
+			auto& tm = params.time_manager;
+			long long latency = end_time - (tm.StartTime() + tm.MaximumTime()) * 1000;
+			total_latency += latency;
+			max_latency = Max(max_latency, latency);
+			num_deadline_stops++;
+		}
+
+		printf("\nAverage go to first info latency (us): %lld\n", total_info_latency / num_searches);
+		printf("Searches stopped by the deadline: %d / %d\n", num_deadline_stops, num_searches);
+		if (num_deadline_stops > 0) {
+			printf("Average stop latency (us): %lld\n", total_latency / num_deadline_stops);
+			printf("Maximum stop latency (us): %lld\n", max_latency);
+		}
+	}
+
+	void RunParallelBench(SearchThread& thread, int depth)
+	{
+		int num_threads = thread.NumThreads();
+		if (num_threads < 2) {
+			printf("Set Threads to 2 or more to compare the parallel modes\n");
+			return;
+		}
+
+		BenchResult single = RunFixedDepth(thread, depth, 1, ParallelMode::LAZY);
+		BenchResult lazy = RunFixedDepth(thread, depth, num_threads, ParallelMode::LAZY);
+		BenchResult abdada = RunFixedDepth(thread, depth, num_threads, ParallelMode::ABDADA);
+
+		printf("\n%-8s %8s %12s %12s %8s %9s\n", "Mode", "Threads", "Time (ms)", "Nodes", "Speedup", "Overhead");
+		auto print_row = [&](const char* name, int threads, const BenchResult& r) {
+			double speedup = single.time / static_cast<double>(r.time);
+			double overhead = 100.0 * (r.nodes / static_cast<double>(single.nodes) - 1.0);
+			printf("%-8s %8d %12lld %12" PRIu64 " %8.2f %8.1f%%\n", name, threads, r.time, r.nodes, speedup, overhead);
+		};
+		print_row("Single", 1, single);
+		print_row("Lazy", num_threads, lazy);
+		print_row("ABDADA", num_threads, abdada);
+	}
+
+	void RunSliderBench(int iterations)
+	{
+		constexpr int num_positions = sizeof(bench_fens) / sizeof(bench_fens[0]);
+		SliderSet sets[num_positions];
+		GameState pos;
+		for (int i = 0; i < num_positions; i++) {
+			pos.LoadPosition(bench_fens[i]);
+			SliderSet& set = sets[i];
+			set.occupancy = pos.Occupancy();
+			Bitboard sliders = pos.Bishops() | pos.Rooks() | pos.Queens();
+			while (sliders) {
+				Square sq = bitboard::PopBit(sliders);
+				set.squares[set.count] = sq;
+				set.pieces[set.count++] = pos.GetPiece(sq);
+			}
+		}
+
+		u64 checksum = 0;
+		long long start_time = Timer::GetTimeInUs();
+		for (int n = 0; n < iterations; n++) {
+			for (const SliderSet& set : sets) {
+				for (int i = 0; i < set.count; i++)
+					checksum += bitboard::PopCount(SliderAttacksScalar(set.squares[i], set.pieces[i], set.occupancy));
+			}
+		}
+		long long scalar_time = Max(Timer::GetTimeInUs() - start_time, 1LL);
+		double num_evaluated = static_cast<double>(iterations) * num_positions;
+		printf("Magic lookups: %.1f ns per position (checksum %" PRIu64 ")\n", scalar_time * 1000.0 / num_evaluated, checksum);
+
+	#ifdef __AVX2__
+		for (const SliderSet& set : sets) {
+			for (int i = 0; i < set.count; i += 4) {
+				Bitboard att[4];
+				int count = Min(4, set.count - i);
+				attacks::SliderAttacksX4(&set.squares[i], &set.pieces[i], count, set.occupancy, att);
+				for (int j = 0; j < count; j++) {
+					if (att[j] != SliderAttacksScalar(set.squares[i + j], set.pieces[i + j], set.occupancy)) {
+						fprintf(stderr, "AnkaError(Bench): SIMD slider attacks differ on square %d\n", set.squares[i + j]);
+						return;
+					}
+				}
+			}
+		}
+
+		checksum = 0;
+		start_time = Timer::GetTimeInUs();
+		for (int n = 0; n < iterations; n++) {
+			for (const SliderSet& set : sets) {
+				for (int i = 0; i < set.count; i += 4) {
+					Bitboard att[4];
+					int count = Min(4, set.count - i);
+					attacks::SliderAttacksX4(&set.squares[i], &set.pieces[i], count, set.occupancy, att);
+					for (int j = 0; j < count; j++)
+						checksum += bitboard::PopCount(att[j]);
+				}
+			}
+		}
+		long long simd_time = Max(Timer::GetTimeInUs() - start_time, 1LL);
+		printf("SIMD fills:    %.1f ns per position (checksum %" PRIu64 ")\n", simd_time * 1000.0 / num_evaluated, checksum);
+		printf("Speedup: %.2f\n", scalar_time / static_cast<double>(simd_time));
+	#else
+		printf("SIMD slider attacks need an AVX2 build\n");
+	#endif
+	}
+
+	void RunEvalBench(int iterations)
+	{
+		// the benchmark positions and all their children
+		std::vector<std::unique_ptr<GameState>> positions;
+		for (const char* fen : bench_fens) {
+			GameState root;
+			root.LoadPosition(fen);
+			positions.push_back(std::make_unique<GameState>());
+			positions.back()->CopyFrom(root);
+
+			MoveList<256> list;
+			list.GenerateLegalMoves(root);
+			for (int i = 0; i < list.length; i++) {
+				positions.push_back(std::make_unique<GameState>());
+				positions.back()->CopyFrom(root);
+				positions.back()->MakeMove(list.moves[i].move);
+			}
+		}
+
+		const size_t num_positions = positions.size();
+		if (!CheckLazyEvaluation(positions))
+			return;
+
+		// the cache is cleared before each pass (outside the timing), so every position is evaluated in full
+		i64 checksum = 0;
+		long long single_time = 0;
+		for (int n = 0; n < iterations; n++) {
+			ClearEvalCache();
+			long long start_time = Timer::GetTimeInUs();
+			for (size_t i = 0; i < num_positions; i++)
+				checksum += positions[i]->ClassicalEvaluation();
+			single_time += Timer::GetTimeInUs() - start_time;
+		}
+		single_time = Max(single_time, 1LL);
+		double num_evaluated = static_cast<double>(iterations) * num_positions;
+		printf("Positions: %zu\n", num_positions);
+		printf("ClassicalEvaluation: %.1f ns per position (checksum %" PRIi64 ")\n", single_time * 1000.0 / num_evaluated, checksum);
+	}
+
+	void RunPackedEvalBench(const char* path)
+	{
+		PackedPositionFile file;
+		if (!file.Open(path))
+			return;
+
+		// the positions are unpacked one at a time into the same state, so memory use doesn't grow with the file
+		auto pos = std::make_unique<GameState>();
+		ClearEvalCache();
+		i64 checksum = 0;
+		long long eval_time = 0;
+		for (size_t i = 0; i < file.Size(); i++) {
+			if (!pos->LoadPacked(file.Positions()[i])) {
+				fprintf(stderr, "AnkaError(Bench): Invalid position %zu in %s\n", i, path);
+				return;
+			}
+
+			long long start_time = Timer::GetTimeInUs();
+			checksum += pos->ClassicalEvaluation();
+			eval_time += Timer::GetTimeInUs() - start_time;
+		}
+
+		printf("Positions: %zu\n", file.Size());
+		printf("ClassicalEvaluation: %.1f ns per position (checksum %" PRIi64 ")\n",
+			Max(eval_time, 1LL) * 1000.0 / Max(file.Size(), static_cast<size_t>(1)), checksum);
+	}
+
+	void RunPawnSetCheck(const char* path)
+	{
+		FILE* file = fopen(path, "r");
+		if (!file) {
+			fprintf(stderr, "AnkaError(Bench): Failed to open %s\n", path);
+			return;
+		}
+
+		constexpr int BUFFER_SIZE = 4096;
+		char line[BUFFER_SIZE];
+		int line_number = 0;
+		u64 num_positions = 0;
+		u64 num_mismatches = 0;
+		std::unordered_set<u64> pawn_keys;
+		GameState pos;
+		while (fgets(line, BUFFER_SIZE, file)) {
+			line_number++;
+			if (line[strspn(line, " \t\r\n")] == '\0')
+				continue;
+
+			// the first four fields of an EPD line are a FEN without the move counters
+			char* field = line;
+			for (int i = 0; i < 4 && field; i++) {
+				field = strchr(field + (i > 0), ' ');
+			}
+			if (field)
+				*field = '\0';
+
+			if (!pos.LoadPosition(line)) {
+				fprintf(stderr, "AnkaError(Bench): Invalid position on line %d of %s\n", line_number, path);
+				break;
+			}
+
+			// the position and all its children
+			MoveList<256> list;
+			list.GenerateLegalMoves(pos);
+			for (int i = -1; i < list.length; i++) {
+				if (i >= 0)
+					pos.MakeMove(list.moves[i].move);
+
+				int mismatches = CheckPawnSets(pos);
+				if (mismatches > 0 && num_mismatches == 0)
+					fprintf(stderr, "AnkaError(Bench): Pawn sets differ from the reference on line %d of %s\n", line_number, path);
+				num_mismatches += mismatches;
+				num_positions++;
+				pawn_keys.insert(pos.PawnKey());
+
+				if (i >= 0)
+					pos.UndoMove();
+			}
+		}
+		fclose(file);
+
+		printf("Positions: %" PRIu64 "\n", num_positions);
+		printf("Pawn structures: %zu\n", pawn_keys.size());
+		printf("Mismatching sides: %" PRIu64 "\n", num_mismatches);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "core.hpp"
+#include "searchthread.hpp"
+
+namespace anka {
+	// Searches a fixed set of positions with "go movetime" and reports the time
+	// between the search deadline and the bestmove output, and between go and the first info output.
+	void RunStopLatencyBench(SearchThread& thread, int movetime);
+
+	// Searches the same positions to a fixed depth with one thread and then with the thread's
+	// thread count in Lazy and ABDADA modes. Reports the time to depth speedup and the search
+	// overhead (extra nodes) of each parallel mode. Parallel searches aren't deterministic,
+	// so results vary between runs.
+	void RunParallelBench(SearchThread& thread, int depth);
+
+	// Generates the attacks of all bishops, rooks and queens of the benchmark positions 'iterations' times
+	// with the magic lookups and, in AVX2 builds, with the SIMD fills of attacks::SliderAttacksX4. Checks that both give the same
+	// attacks and reports the time per position.
+	void RunSliderBench(int iterations);
+
+	// Evaluates the benchmark positions and their children 'iterations' times with ClassicalEvaluation.
+	// Checks that the evaluation and its lazy estimate are the same for each position and its color mirror,
+	// and reports the time per position.
+	void RunEvalBench(int iterations);
+
+	// Streams the positions of a packed position file (see packedpos.hpp) through ClassicalEvaluation
+	// and reports the time per position.
+	void RunPackedEvalBench(const char* path);
+
+	// Compares the set-wise pawn structure with a per pawn reference for each position of an EPD file
+	// and all its children. Reports the number of positions, pawn structures and mismatching sides.
+	void RunPawnSetCheck(const char* path);
+}
@@ -0,0 +1,141 @@
+#include "timeman.hpp"
+#include "util.hpp"
+
+namespace anka {
+	namespace {
+		constexpr int DEFAULT_MOVES_TO_GO = 30;
+		constexpr int MAX_MOVES_TO_GO = 50;
+		constexpr long long MAX_TIME_RATIO = 4; // maximum time / optimum time
+		constexpr int MAX_STABILITY = 4;
+
+		// optimum time multipliers indexed by the number of iterations the best move stayed the same
+		constexpr double stability_scale[MAX_STABILITY + 1] = { 2.00, 1.40, 1.10, 0.90, 0.75 };
+	}
+
+	void TimeManager::Init(const TimeControl& tc, int move_overhead, long long start_time)
+	{
+		Clear();
+		SetStartTime(start_time);
+		m_fixed_time = tc.movetime > 0;
+
+		if (m_fixed_time) {
+			m_optimum_time = Max(tc.movetime - move_overhead, 1LL);
+			m_maximum_time = m_optimum_time;
+			return;
+		}
+
+		int movestogo = DEFAULT_MOVES_TO_GO;
+		if (tc.movestogo > 0)
+			movestogo = Min(tc.movestogo, MAX_MOVES_TO_GO);
+
+		// Reserve the move overhead once for this move. The increment is only added after the move is made,
+		// so it can't be relied on when the clock is low.
+		long long available = Max(tc.time_left - move_overhead, 1LL);
+		long long hard_cap = (movestogo == 1) ? (available * 3) / 4 : available / 2;
+
+		m_optimum_time = available / movestogo + (tc.increment * 3) / 4;
+		m_maximum_time = m_optimum_time * MAX_TIME_RATIO;
+
+		m_maximum_time = Clamp(m_maximum_time, 1LL, Max(hard_cap, 1LL));
+		m_optimum_time = Clamp(m_optimum_time, 1LL, m_maximum_time);
+	}
+
+	void TimeManager::Clear()
+	{
+		SetStartTime(0);
+		m_optimum_time = 0;
+		m_maximum_time = 0;
+		m_fixed_time = false;
+		m_prev_best_move = move::NO_MOVE;
+		m_prev_score = 0;
+		m_has_prev_iteration = false;
+		m_stability = 0;
+		m_score_drop = 0;
+	}
+
+	void TimeManager::Update(Move best_move, int best_score)
+	{
+		if (best_move == m_prev_best_move)
+			m_stability = Min(m_stability + 1, MAX_STABILITY);
+		else
+			m_stability = 0;
+
+		// positive if the score went down since the last iteration, the first iteration has nothing to compare with
+		m_score_drop = m_has_prev_iteration ? m_prev_score - best_score : 0;
+
+		m_prev_best_move = best_move;
+		m_prev_score = best_score;
+		m_has_prev_iteration = true;
+	}
+
+	long long TimeManager::ScaledOptimumTime() const
+	{
+		if (m_fixed_time)
+			return m_maximum_time;
+
+		// spend up to twice the optimum time after losing a pawn or more
+		double score_scale = 1.0 + Clamp(m_score_drop, 0, 100) / 100.0;
+		double scale = stability_scale[m_stability] * score_scale;
+		long long scaled_time = static_cast<long long>(m_optimum_time * scale);
+
+		return Min(scaled_time, m_maximum_time);
+	}
+
+	DeadlineTimer::DeadlineTimer()
+	{
+		m_thread = std::thread(&DeadlineTimer::Loop, this);
+	}
+
+	DeadlineTimer::~DeadlineTimer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_cv.notify_one();
+		m_thread.join();
+	}
+
+	void DeadlineTimer::Arm(long long deadline, std::atomic<bool>* stop_flag)
+	{
+		// convert to the steady clock so that the wait isn't affected by system clock adjustments
+		long long us_left = deadline * 1000 - Timer::GetTimeInUs();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(us_left);
+			m_stop_flag = stop_flag;
+			m_armed = true;
+		}
+		m_cv.notify_one();
+	}
+
+	void DeadlineTimer::Disarm()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_armed = false;
+			m_stop_flag = nullptr;
+		}
+		m_cv.notify_one();
+	}
+
+	void DeadlineTimer::Loop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_exit) {
+			if (!m_armed) {
+				m_cv.wait(lock);
+				continue;
+			}
+
+			// wakes up early if the deadline is re-armed or cancelled
+			if (m_cv.wait_until(lock, m_deadline) == std::cv_status::timeout && m_armed
+				&& std::chrono::steady_clock::now() >= m_deadline)
+			{
+				m_stop_flag->store(true, std::memory_order_relaxed);
+				m_armed = false;
+				m_stop_flag = nullptr;
+			}
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "core.hpp"
+#include "move.hpp"
+#include "timer.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace anka {
+	// Clock information received with a "go" command. Values are from the side to move's perspective.
+	struct TimeControl {
+		long long time_left = 0;
+		long long increment = 0;
+		long long movetime = 0;
+		int movestogo = 0;
+	};
+
+	/* Decides how long a search is allowed to run.
+	* optimum time: soft limit, checked between iterations. It is scaled with best move and score stability.
+	* maximum time: hard limit, the search is aborted when it is exceeded.
+	*/
+	class TimeManager {
+	public:
+		void Init(const TimeControl& tc, int move_overhead, long long start_time);
+		void Clear();
+
+		// Called after each completed iteration with the iteration's best move and score
+		void Update(Move best_move, int best_score);
+
+		// Returns true if there isn't enough time left to start a new iteration
+		bool SoftTimeUp(long long curr_time) const
+		{
+			return Elapsed(curr_time) >= ScaledOptimumTime();
+		}
+
+		long long ScaledOptimumTime() const;
+		force_inline long long OptimumTime() const { return m_optimum_time; }
+		force_inline long long MaximumTime() const { return m_maximum_time; }
+		force_inline long long StartTime() const { return m_start_time.load(std::memory_order_relaxed); }
+		force_inline void SetStartTime(long long start_time) { m_start_time.store(start_time, std::memory_order_relaxed); }
+		force_inline long long Elapsed(long long curr_time) const { return curr_time - StartTime(); }
+	private:
+		// set by the uci thread on ponderhit while the search thread reads it
+		std::atomic<long long> m_start_time = 0;
+		long long m_optimum_time = 0;
+		long long m_maximum_time = 0;
+		bool m_fixed_time = false; // "go movetime", no scaling
+
+		// search stability info
+		Move m_prev_best_move = move::NO_MOVE;
+		int m_prev_score = 0;
+		bool m_has_prev_iteration = false; // m_prev_best_move and m_prev_score are set
+		int m_stability = 0; // number of consecutive iterations with the same best move
+		int m_score_drop = 0; // score loss in the last iteration, in centipawns
+	};
+
+	/* A parked thread that raises a stop flag when a deadline passes.
+	* The search only reads the flag, so it never has to poll the clock and the stop latency
+	* doesn't depend on the search speed.
+	*/
+	class DeadlineTimer {
+	public:
+		DeadlineTimer();
+		~DeadlineTimer();
+		DeadlineTimer(const DeadlineTimer&) = delete;
+		DeadlineTimer& operator=(const DeadlineTimer&) = delete;
+
+		// Sets 'stop_flag' at 'deadline' (in Timer::GetTimeInMs units). Replaces any armed deadline.
+		void Arm(long long deadline, std::atomic<bool>* stop_flag);
+
+		// Cancels the armed deadline. The stop flag isn't touched after this returns.
+		void Disarm();
+	private:
+		void Loop();
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::chrono::steady_clock::time_point m_deadline;
+		std::atomic<bool>* m_stop_flag = nullptr;
+		bool m_armed = false;
+		bool m_exit = false;
+		std::thread m_thread;
+	};
+}
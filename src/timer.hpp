@@ -20,6 +20,14 @@ namespace anka {
 			return now_ms.count();
 		}
 
+		force_inline static long long GetTimeInUs()
+		{
+			auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+			auto now_us = std::chrono::duration_cast<std::chrono::microseconds>(now);
+
+			return now_us.count();
+		}
+
 		~Timer()
 		{
 			auto endpoint = std::chrono::high_resolution_clock::now();
@@ -6,11 +6,12 @@
 #include "movegen.hpp"
 #include <string.h>
 #include <inttypes.h>
+#include <atomic>
 namespace anka {
 
 	enum class NodeType { EXACT, UPPERBOUND, LOWERBOUND, NONE };
 
-	// Each record is 12 bytes
+	// A decoded table entry. Each record is 12 bytes
 	struct TTRecord {
 		u32 key;
 		u32 move;
@@ -40,7 +41,7 @@ namespace anka {
 
 		void Clear()
 		{
-			memset(m_table, 0, m_table_size);
+			memset(static_cast<void*>(m_table), 0, m_table_size);
 			m_current_age = 0;
 			m_table_hits = 0;
 			m_num_queries = 0;
@@ -85,8 +86,7 @@ namespace anka {
 			u32 pos_key = static_cast<u32>(pos_hash >> 32);
 
 			for (int i = 0; i < num_cells; i++) {
-				if (m_table[bucket_index].records[i].key == pos_key) {
-					result = m_table[bucket_index].records[i];
+				if (m_table[bucket_index].records[i].Load(pos_key, result)) {
 					if (result.value > UPPER_MATE_THRESHOLD) {
 						result.value -= ply;
 					}
@@ -116,17 +116,19 @@ namespace anka {
 			int min_depth = MAX_DEPTH + 1;
 			// replacement strategy: same entry > different age > lower depth
 			for (int i = 0; i < num_cells; i++) {
-				if (pos_key == m_table[bucket_index].records[i].key) {
+				// a torn entry decodes to garbage here, which at worst picks a worse cell to replace
+				TTRecord record;
+				if (m_table[bucket_index].records[i].Load(pos_key, record)) {
 					chosen_index = i;
 					break;
 				}
-				int record_age = m_table[bucket_index].records[i].GetAge();
+				int record_age = record.GetAge();
 				if (record_age != m_current_age) {
 					chosen_index = i;
 				}
 
-				if (chosen_index == - 1 && m_table[bucket_index].records[i].depth < min_depth) {
-					min_depth = m_table[bucket_index].records[i].depth;
+				if (chosen_index == - 1 && record.depth < min_depth) {
+					min_depth = record.depth;
 					chosen_index = i;
 				}
 			}
@@ -139,11 +141,13 @@ namespace anka {
 			else if (value < LOWER_MATE_THRESHOLD) {
 				value -= ply;
 			}
-			m_table[bucket_index].records[chosen_index].key = pos_key;
-			m_table[bucket_index].records[chosen_index].value = value;
-			m_table[bucket_index].records[chosen_index].depth = depth;
-			m_table[bucket_index].records[chosen_index].move = best_move;
-			m_table[bucket_index].records[chosen_index].node_type_and_age = type_and_age;
+			TTRecord record;
+			record.key = pos_key;
+			record.move = best_move;
+			record.value = value;
+			record.depth = static_cast<byte>(depth);
+			record.node_type_and_age = static_cast<byte>(type_and_age);
+			m_table[bucket_index].records[chosen_index].Store(record);
 		}
 
 		// extracts the principal variation moves into pv. returns the number of extracted moves.
@@ -211,11 +215,13 @@ namespace anka {
 
 				int n_used_cells = 0;
 				for (int r = 0; r < num_cells; r++) {
-					if (bucket.records[r].key > 0) {
+					TTRecord record;
+					bucket.records[r].Decode(record);
+					if (bucket.records[r].checked_key.load(std::memory_order_relaxed) > 0) {
 						n_used_cells++;
 						n_total_used_cells++;
 
-						switch (bucket.records[r].GetNodeType())
+						switch (record.GetNodeType())
 						{
 						case NodeType::EXACT:
 							n_exact++;
@@ -255,19 +261,56 @@ namespace anka {
 		static constexpr size_t MiB = 1'048'576;
 
 		/**
-		 * TTRecord Encoding
-		 * key:
-		 *	LSB32 of positionkey // 32 bits
-		 * data:
-		 *	[0:31]  : best move // 32 bits
-		 *  [32:47] : value // 16 bits
-		 *  [48:55] : depth // 8 bits
-		 *  [56:63] : node type and age // 2 bits and 6 bits
+		 * TTEntry Encoding
+		 * checked_key:
+		 *	MSB32 of positionkey ^ move ^ info // 32 bits
+		 * move:
+		 *	best move // 32 bits
+		 * info:
+		 *	[0:15]  : value // 16 bits
+		 *  [16:23] : depth // 8 bits
+		 *  [24:31] : node type and age // 2 bits and 6 bits
+		 *
+		 * Search threads read and write entries concurrently without locks. The words are stored
+		 * separately, so a reader can see the words of two different writes. Such an entry fails
+		 * the key check because the key is xored with the data it was written with.
 		*/
+		struct TTEntry {
+			std::atomic<u32> checked_key;
+			std::atomic<u32> move;
+			std::atomic<u32> info;
+
+			force_inline void Store(const TTRecord& record)
+			{
+				u32 packed_info = static_cast<u16>(record.value) | (record.depth << 16) | (record.node_type_and_age << 24);
+				checked_key.store(record.key ^ record.move ^ packed_info, std::memory_order_relaxed);
+				move.store(record.move, std::memory_order_relaxed);
+				info.store(packed_info, std::memory_order_relaxed);
+			}
+
+			// decodes the entry without verifying it
+			force_inline void Decode(TTRecord& record) const
+			{
+				u32 packed_info = info.load(std::memory_order_relaxed);
+				record.move = move.load(std::memory_order_relaxed);
+				record.value = static_cast<i16>(packed_info & 0xffff);
+				record.depth = static_cast<byte>(packed_info >> 16);
+				record.node_type_and_age = static_cast<byte>(packed_info >> 24);
+				record.key = checked_key.load(std::memory_order_relaxed) ^ record.move ^ packed_info;
+			}
+
+			// returns true if the entry holds a complete record for the key
+			force_inline bool Load(u32 pos_key, TTRecord& record) const
+			{
+				Decode(record);
+				return record.key == pos_key;
+			}
+		};
+		static_assert(sizeof(TTEntry) == 12, "TTEntry: unexpected struct alignment");
 
 		// Each bucket is 64 bytes
 		struct TTBucket {
-			TTRecord records[num_cells];
+			TTEntry records[num_cells];
 			u32 padding;
 		};
 		static_assert(sizeof(TTBucket) == 64, "TTBucket: unexpected size");
@@ -20,6 +20,25 @@ namespace anka {
 			valid = false;
 		}
 
+		if (m_pawn_key != CalculatePawnKey()) {
+			std::cerr << "AnkaError (Validate): Calculated pawn key mismatch with incrementally updated pawn key.\n";
+			valid = false;
+		}
+
+		if (m_material_key != CalculateMaterialKey()) {
+			std::cerr << "AnkaError (Validate): Calculated material key mismatch with incrementally updated material key.\n";
+			valid = false;
+		}
+
+		// validate material and piece-square scores
+		Score psqt;
+		int phase_material;
+		CalculatePSQT(psqt, phase_material);
+		if (m_psqt != psqt || m_phase_material != phase_material) {
+			std::cerr << "AnkaError (Validate): Calculated PSQT score mismatch with incrementally updated score.\n";
+			valid = false;
+		}
+
 		// validate mailbox and bitboards
 		if ((Pieces<WHITE>() & Pieces<BLACK>()) != C64(0)) {
 			std::cerr << "AnkaError (Validate): White Pieces and Black Pieces share elements.\n";